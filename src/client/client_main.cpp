@@ -2,6 +2,8 @@
 #include <iostream>
 #include <signal.h>
 #include <unistd.h>
+#include <cstring>
+#include <string>
 
 bool running = true;
 
@@ -10,7 +12,18 @@ void signal_handler(int) {
     running = false;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --trace <fichier> : étapes de chaque requête, écrites à la sortie
+    std::string trace_path;
+    if (argc == 3 && strcmp(argv[1], "--trace") == 0) {
+        trace_path = argv[2];
+        IPCTrace::enable();
+    }
+    else if (argc != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--trace <fichier>]" << std::endl;
+        return 1;
+    }
+
     // Gérer l'arrêt propre avec Ctrl+C
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -61,6 +74,35 @@ int main() {
         all_tests_passed = false;
     }
 
+    // Test lot de bytecodes
+    if (!client.test_batch_bytecode()) {
+        std::cerr << "Échec du test de lot de bytecodes" << std::endl;
+        all_tests_passed = false;
+    }
+
+    // Test charges utiles plus grandes qu'un slot
+    if (!client.test_large_bytecode()) {
+        std::cerr << "Échec du test de gros bytecode" << std::endl;
+        all_tests_passed = false;
+    }
+
+    // Test lectures sur place dans le fichier de cache
+    if (!client.test_read_cached()) {
+        std::cerr << "Échec du test de lecture par référence" << std::endl;
+        all_tests_passed = false;
+    }
+
+    // Test requêtes en vol
+    if (!client.test_pipelined_requests()) {
+        std::cerr << "Échec du test de requêtes en vol" << std::endl;
+        all_tests_passed = false;
+    }
+
+    if (!client.test_stats()) {
+        std::cerr << "Échec du test des métriques" << std::endl;
+        all_tests_passed = false;
+    }
+
     // Afficher le résultat
     std::cout << "\n=== RÉSULTATS DES TESTS ===" << std::endl;
     if (all_tests_passed) {
@@ -78,6 +120,9 @@ int main() {
 
     client.disconnect();
     std::cout << "Client fermé." << std::endl;
+    if (!trace_path.empty()) {
+        IPCTrace::dump(trace_path.c_str(), "cache_client");
+    }
 
     return all_tests_passed ? 0 : 1;
 }
@@ -1,9 +1,55 @@
 #include "client_test.h"
+#include "../m_cache/m_graph_serializer.h"
 #include <iostream>
 #include <cstring>
 #include <unistd.h>
+#include <cerrno>
+#include <dirent.h>
+#include <stdexcept>
 
-IPCClient::IPCClient() : shared_data(nullptr), connected(false) {}
+IPCResponse::~IPCResponse()
+{
+    reset();
+}
+
+IPCResponse::IPCResponse(IPCResponse&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+IPCResponse& IPCResponse::operator=(IPCResponse&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        shared_data = other.shared_data;
+        slot = other.slot;
+        mapping = other.mapping;
+        response_data = other.response_data;
+        response_size = other.response_size;
+        other.slot = nullptr;
+        other.mapping = nullptr;
+        other.response_data = nullptr;
+        other.response_size = 0;
+    }
+    return *this;
+}
+
+void IPCResponse::reset()
+{
+    if (mapping) {
+        munmap(mapping, response_size);
+    }
+    if (slot) {
+        ipc_slot_consume(shared_data, *slot);
+    }
+    slot = nullptr;
+    mapping = nullptr;
+    response_data = nullptr;
+    response_size = 0;
+}
+
+IPCClient::IPCClient()
+    : shared_data(nullptr), connected(false), mailbox(-1), mailbox_generation(0), completion_stop(false) {}
 
 IPCClient::~IPCClient()
 {
@@ -14,6 +60,14 @@ bool IPCClient::connect()
 {
     shared_data = open_shared_memory();
     if (shared_data) {
+        // Chaque client reçoit ses réponses dans sa propre boîte
+        mailbox = ipc_mailbox_claim(shared_data, &mailbox_generation);
+        if (mailbox < 0) {
+            std::cerr << "Trop de clients connectés" << std::endl;
+            munmap(shared_data, sizeof(SharedData));
+            shared_data = nullptr;
+            return false;
+        }
         connected = true;
         std::cout << "Client connecté au serveur IPC" << std::endl;
         return true;
@@ -24,6 +78,23 @@ bool IPCClient::connect()
 void IPCClient::disconnect()
 {
     if (shared_data && connected) {
+        stop_completion();
+
+        // Les réponses déjà écrites mais jamais lues sont rendues au pool ;
+        // celles encore en cours le seront par le serveur
+        for (const auto& entry : pending) {
+            ipc_slot_abandon(shared_data, shared_data->slots[entry.second.slot_index]);
+        }
+        pending.clear();
+        for (auto& entry : async_pending) {
+            ipc_slot_abandon(shared_data, shared_data->slots[entry.second.slot_index]);
+            entry.second.promise.set_exception(
+                std::make_exception_ptr(std::runtime_error("Client déconnecté")));
+        }
+        async_pending.clear();
+        ipc_mailbox_release(shared_data, mailbox);
+        mailbox = -1;
+        cache_reader.Close();
         munmap(shared_data, sizeof(SharedData));
         shared_data = nullptr;
         connected = false;
@@ -52,70 +123,440 @@ SharedData* IPCClient::open_shared_memory()
     return data;
 }
 
-bool IPCClient::send_message(const void* message_data, size_t message_size, const std::string& route_hash)
+bool IPCClient::send_message(const void* message_data, size_t message_size, uint32_t route_id,
+    uint32_t* message_id)
+{
+    uint32_t id;
+    uint32_t index;
+    uint64_t deadline_ns = request_deadline();
+    if (!publish_request(message_data, message_size, route_id, message_id != nullptr, deadline_ns,
+            &id, &index)) {
+        return false;
+    }
+    if (message_id) {
+        *message_id = id;
+        pending[id] = PendingRequest{index, deadline_ns};
+    }
+    return true;
+}
+
+uint64_t IPCClient::request_deadline() const
+{
+    if (options.timeout.count() <= 0) {
+        return 0;
+    }
+    return ipc_now_ns() + std::chrono::duration_cast<std::chrono::nanoseconds>(options.timeout).count();
+}
+
+std::future<IPCResponse> IPCClient::send_async(const void* message_data, size_t message_size,
+    uint32_t route_id)
+{
+    std::promise<IPCResponse> promise;
+    std::future<IPCResponse> future = promise.get_future();
+
+    // Publication hors verrou : elle peut attendre un slot libre, que seul
+    // le thread de complétion rend parfois
+    uint32_t id;
+    uint32_t index;
+    uint64_t deadline_ns = request_deadline();
+    if (!publish_request(message_data, message_size, route_id, true, deadline_ns, &id, &index)) {
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("Envoi de la requête impossible")));
+        return future;
+    }
+    {
+        std::lock_guard<std::mutex> lock(async_mutex);
+        async_pending.emplace(id, AsyncRequest{index, deadline_ns, std::move(promise), IPCTrace::start()});
+    }
+
+    if (!completion_thread.joinable()) {
+        completion_stop = false;
+        completion_thread = std::thread(&IPCClient::completion_loop, this);
+    }
+    // Réponse arrivée avant l'enregistrement : son signal a pu être consommé
+    // par un passage qui ne connaissait pas encore la requête
+    if (shared_data->slots[index].state.load(std::memory_order_acquire) == IPC_SLOT_COMPLETED) {
+        ipc_event_signal(&shared_data->mailboxes[mailbox].ready);
+    }
+    return future;
+}
+
+void IPCClient::completion_loop()
+{
+    IPCEvent* ready = &shared_data->mailboxes[mailbox].ready;
+    IPCSpinBudget completion_spin;
+    std::vector<std::pair<std::promise<IPCResponse>, IPCResponse>> done;
+
+    while (!completion_stop.load(std::memory_order_acquire)) {
+        uint32_t seen = ipc_event_prepare(ready);
+
+        // Relever les réponses arrivées et les requêtes échues, puis les
+        // livrer hors du verrou ; dormir au plus jusqu'à la prochaine échéance
+        uint64_t now = ipc_now_ns();
+        uint64_t next_deadline = 0;
+        {
+            std::lock_guard<std::mutex> lock(async_mutex);
+            for (auto it = async_pending.begin(); it != async_pending.end();) {
+                AsyncRequest& request = it->second;
+                IPCSlot& slot = shared_data->slots[request.slot_index];
+                if (slot.state.load(std::memory_order_acquire) == IPC_SLOT_COMPLETED) {
+                    IPCTrace::finish("client.async_wait", request.traced_ns, it->first);
+                    const char* rejection = ipc_response_rejection(slot);
+                    IPCResponse response;
+                    if (take_response(slot, it->first, response)) {
+                        done.emplace_back(std::move(request.promise), std::move(response));
+                    }
+                    else {
+                        request.promise.set_exception(std::make_exception_ptr(
+                            std::runtime_error(rejection ? rejection : "Réponse invalide")));
+                    }
+                }
+                else if (request.deadline_ns != 0 && now >= request.deadline_ns && ipc_slot_cancel(slot)) {
+                    request.promise.set_exception(
+                        std::make_exception_ptr(std::runtime_error("Délai de réponse dépassé")));
+                }
+                else {
+                    if (request.deadline_ns != 0 && (next_deadline == 0 || request.deadline_ns < next_deadline)) {
+                        next_deadline = request.deadline_ns;
+                    }
+                    ++it;
+                    continue;
+                }
+                it = async_pending.erase(it);
+            }
+        }
+        for (auto& entry : done) {
+            entry.first.set_value(std::move(entry.second));
+        }
+        done.clear();
+
+        ipc_event_wait(ready, seen, &completion_spin, next_deadline);
+    }
+}
+
+void IPCClient::stop_completion()
+{
+    if (completion_thread.joinable()) {
+        completion_stop = true;
+        ipc_event_signal(&shared_data->mailboxes[mailbox].ready);
+        completion_thread.join();
+    }
+}
+
+bool IPCClient::publish_request(const void* message_data, size_t message_size, uint32_t route_id,
+    bool expects_response, uint64_t deadline_ns, uint32_t* message_id, uint32_t* slot_index)
 {
     if (!connected || !shared_data) {
         std::cerr << "Client non connecté" << std::endl;
         return false;
     }
 
-    if (message_size > MAX_MESSAGE_SIZE - sizeof(IPCMessage)) {
+    if (message_size > UINT32_MAX) {
         std::cerr << "Message trop volumineux" << std::endl;
         return false;
     }
 
-    // Attendre l'accès exclusif
-    sem_wait(&shared_data->mutex);
+    // Une charge utile trop grande pour le slot est écrite dans un segment
+    // dédié avant de réserver le slot, pour ne pas garder un slot pendant la copie
+    const uint64_t traced = IPCTrace::start();
+    uint32_t id = generate_message_id(shared_data);
+    bool external = message_size > MAX_MESSAGE_SIZE - sizeof(IPCMessage);
+    IPCExternalBuffer buffer;
+    if (external) {
+        ipc_external_init(&buffer, "req", id, message_size);
+        void* segment = ipc_external_create(buffer);
+        if (!segment) {
+            return false;
+        }
+        memcpy(segment, message_data, message_size);
+        munmap(segment, message_size);
+    }
+
+    // Prendre un slot libre ; d'autres clients écrivent en parallèle
+    const uint64_t acquiring = IPCTrace::start();
+    uint32_t index = 0;
+    bool acquired = ipc_slot_acquire(shared_data, mailbox, mailbox_generation, deadline_ns, &index);
+    IPCTrace::finish("client.slot_wait", acquiring, id);
+    if (!acquired) {
+        std::cerr << "Aucun slot libre avant l'échéance" << std::endl;
+        if (external) {
+            shm_unlink(buffer.name);
+        }
+        return false;
+    }
+    IPCSlot& slot = shared_data->slots[index];
 
     // Construire le message IPC
-    IPCMessage* ipc_msg = (IPCMessage*)shared_data->message;
-    ipc_msg->message_id = generate_message_id();
-    strncpy(ipc_msg->route_hash, route_hash.c_str(), sizeof(ipc_msg->route_hash) - 1);
-    ipc_msg->route_hash[sizeof(ipc_msg->route_hash) - 1] = '\0';
+    IPCMessage* ipc_msg = (IPCMessage*)slot.message;
+    ipc_msg->message_id = id;
+    ipc_msg->priority = options.priority;
+    ipc_msg->deadline_ns = deadline_ns;
+    ipc_msg->route_id = route_id;
     ipc_msg->payload_size = message_size;
 
     // Copier les données
-    memcpy(ipc_msg->payload, message_data, message_size);
-
-    shared_data->message_size = sizeof(IPCMessage) + message_size;
-    shared_data->has_message = true;
-    shared_data->current_message_id = ipc_msg->message_id;
+    slot.flags = expects_response ? IPC_SLOT_EXPECTS_RESPONSE : 0;
+    if (external) {
+        slot.external = buffer;
+        slot.flags |= IPC_SLOT_EXTERNAL_PAYLOAD;
+        slot.message_size = sizeof(IPCMessage);
+    }
+    else {
+        if (message_size > 0) {
+            memcpy(ipc_msg->payload, message_data, message_size);
+        }
+        slot.message_size = sizeof(IPCMessage) + message_size;
+    }
+    slot.client_id = mailbox;
+    slot.client_generation = mailbox_generation;
+    slot.state.store(IPC_SLOT_PENDING, std::memory_order_relaxed);
+    slot.published_ns = IPCTrace::start();
+    *message_id = id;
+    *slot_index = index;
 
     // Signaler qu'un message est prêt
-    sem_post(&shared_data->data_ready);
-
-    // Libérer l'accès
-    sem_post(&shared_data->mutex);
+    ipc_ring_publish(shared_data, index);
+    IPCTrace::finish("client.publish", traced, id, IPC_TRACE_FLOW_START);
 
     return true;
 }
 
 bool IPCClient::wait_for_response(void* response_buffer, size_t& response_size, uint32_t expected_message_id)
+{
+    IPCResponse response;
+    if (!wait_for_response(response, expected_message_id)) {
+        return false;
+    }
+    if (response.size() > MAX_MESSAGE_SIZE) {
+        std::cerr << "Réponse trop volumineuse pour le buffer, utiliser IPCResponse" << std::endl;
+        return false;
+    }
+
+    // Copier la réponse
+    response_size = response.size();
+    memcpy(response_buffer, response.data(), response_size);
+    return true;
+}
+
+bool IPCClient::wait_for_response(IPCResponse& response, uint32_t expected_message_id)
 {
     if (!connected || !shared_data) {
         return false;
     }
 
-    // Attendre la réponse
-    sem_wait(&shared_data->response_ready);
+    auto it = pending.find(expected_message_id);
+    if (it == pending.end()) {
+        std::cerr << "Aucune requête en attente pour ce message" << std::endl;
+        return false;
+    }
+    PendingRequest request = it->second;
+    pending.erase(it);
+    IPCSlot& slot = shared_data->slots[request.slot_index];
+
+    // Attendre la réponse : la boîte est signalée pour chacune de nos
+    // réponses, on revérifie donc l'état du slot à chaque réveil
+    IPCEvent* ready = &shared_data->mailboxes[mailbox].ready;
+    const uint64_t waiting = IPCTrace::start();
+    for (;;) {
+        uint32_t seen = ipc_event_prepare(ready);
+        if (slot.state.load(std::memory_order_acquire) == IPC_SLOT_COMPLETED) break;
+        // Échéance : le serveur rendra le slot ; si la réponse vient
+        // d'arriver, elle est lue malgré tout
+        if (request.deadline_ns != 0 && ipc_now_ns() >= request.deadline_ns && ipc_slot_cancel(slot)) {
+            std::cerr << "Délai de réponse dépassé" << std::endl;
+            return false;
+        }
+        ipc_event_wait(ready, seen, &spin, request.deadline_ns);
+    }
+    IPCTrace::finish("client.wait", waiting, expected_message_id);
+    if (const char* rejection = ipc_response_rejection(slot)) {
+        std::cerr << rejection << std::endl;
+    }
+    return take_response(slot, expected_message_id, response);
+}
 
+bool IPCClient::take_response(IPCSlot& slot, uint32_t expected_message_id, IPCResponse& response)
+{
     // Vérifier l'ID du message
-    if (shared_data->response_message_id != expected_message_id) {
+    if (slot.response_message_id != expected_message_id) {
         std::cerr << "ID de message de réponse incorrect" << std::endl;
+        ipc_slot_consume(shared_data, slot);
+        return false;
+    }
+    if (ipc_response_rejection(slot)) {
+        ipc_slot_consume(shared_data, slot);
         return false;
     }
 
-    // Copier la réponse
-    response_size = shared_data->response_size;
-    memcpy(response_buffer, shared_data->response, response_size);
+    response.reset();
+    response.shared_data = shared_data;
+    if (slot.response_flags & IPC_RESPONSE_EXTERNAL) {
+        // Le mapping survit au slot, rendu tout de suite au pool
+        void* mapping = ipc_external_open(slot.response_external);
+        size_t size = slot.response_external.size;
+        ipc_slot_consume(shared_data, slot);
+        if (!mapping) {
+            return false;
+        }
+        response.mapping = mapping;
+        response.response_data = static_cast<const char*>(mapping);
+        response.response_size = size;
+    }
+    else {
+        response.slot = &slot;
+        response.response_data = slot.response;
+        response.response_size = slot.response_size;
+    }
+    return true;
+}
+
+bool IPCClient::read_cached(uint32_t route_id, const char* function_code_hash,
+    const std::function<void(const uint8_t*, size_t)>& reader)
+{
+    GetCacheRefRequest request;
+    memset(&request, 0, sizeof(request));
+    strncpy(request.function_code_hash, function_code_hash, sizeof(request.function_code_hash) - 1);
+    // Quelques tentatives : une relocalisation pendant la lecture est rare
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        uint32_t message_id;
+        IPCResponse response;
+        if (!send_message(&request, sizeof(request), route_id, &message_id) ||
+            !wait_for_response(response, message_id) ||
+            response.size() < sizeof(GetCacheRefResponse)) {
+            return false;
+        }
+        const GetCacheRefResponse* ref_response = (const GetCacheRefResponse*)response.data();
+        if (!ref_response->success) {
+            return false;
+        }
+        m_cache::CacheRef ref = ref_response->ref;
+        response.reset();
+
+        if (!cache_reader.IsOpen() && !cache_reader.Open(shared_data->cache_path)) {
+            return false;
+        }
+        const uint8_t* data = cache_reader.Data(ref);
+        if (!data) {
+            continue;
+        }
+        reader(data, ref.length);
+        if (cache_reader.Validate(ref)) {
+            return true;
+        }
+    }
+
+    std::cerr << "Entrée relocalisée à chaque lecture" << std::endl;
+    return false;
+}
+
+bool IPCClient::get_many(uint32_t route_id, const std::vector<std::string>& function_code_hashes,
+    const std::function<void(size_t, const uint8_t*, size_t)>& reader, uint32_t* found)
+{
+    std::vector<char> request(sizeof(GetManyRequest));
+    ((GetManyRequest*)request.data())->count = function_code_hashes.size();
+    for (const std::string& hash : function_code_hashes) {
+        request.insert(request.end(), hash.c_str(), hash.c_str() + hash.size() + 1);
+    }
+
+    uint32_t message_id;
+    IPCResponse response;
+    if (!send_message(request.data(), request.size(), route_id, &message_id) ||
+        !wait_for_response(response, message_id) ||
+        response.size() < sizeof(GetManyResponse)) {
+        return false;
+    }
+
+    // Les descripteurs pointent dans la réponse, lue sur place
+    const GetManyResponse* header = (const GetManyResponse*)response.data();
+    if (header->count != function_code_hashes.size() ||
+        (response.size() - sizeof(GetManyResponse)) / sizeof(GetManyEntry) < header->count) {
+        std::cerr << "Réponse groupée mal formée" << std::endl;
+        return false;
+    }
+    for (uint32_t i = 0; i < header->count; ++i) {
+        const GetManyEntry& entry = header->entries[i];
+        if (entry.status != IPC_BATCH_FOUND) {
+            continue;
+        }
+        if (entry.offset > response.size() || entry.size > response.size() - entry.offset) {
+            std::cerr << "Réponse groupée mal formée" << std::endl;
+            return false;
+        }
+        reader(i, (const uint8_t*)response.data() + entry.offset, entry.size);
+    }
+    if (found) {
+        *found = header->found;
+    }
+    return true;
+}
+
+bool IPCClient::put_many(uint32_t route_id, const std::vector<IPCBatchWrite>& writes,
+    std::vector<uint8_t>* status)
+{
+    // Descripteurs puis données, à la suite dans un seul message
+    size_t table_size = sizeof(PutManyRequest) + writes.size() * sizeof(PutManyEntry);
+    size_t total_size = table_size;
+    for (const IPCBatchWrite& write : writes) {
+        total_size += write.size;
+    }
+    std::vector<char> request(total_size);
+    PutManyRequest* header = (PutManyRequest*)request.data();
+    header->count = writes.size();
+    uint64_t data_offset = 0;
+    for (size_t i = 0; i < writes.size(); ++i) {
+        PutManyEntry& entry = header->entries[i];
+        memset(entry.function_code_hash, 0, sizeof(entry.function_code_hash));
+        strncpy(entry.function_code_hash, writes[i].function_code_hash.c_str(),
+            sizeof(entry.function_code_hash) - 1);
+        entry.size = writes[i].size;
+        entry.data_offset = data_offset;
+        memcpy(request.data() + table_size + data_offset, writes[i].data, writes[i].size);
+        data_offset += writes[i].size;
+    }
 
-    // Nettoyer
-    shared_data->has_response = false;
-    shared_data->response_size = 0;
+    uint32_t message_id;
+    IPCResponse response;
+    if (!send_message(request.data(), request.size(), route_id, &message_id) ||
+        !wait_for_response(response, message_id) ||
+        response.size() < sizeof(PutManyResponse)) {
+        return false;
+    }
+    const PutManyResponse* result = (const PutManyResponse*)response.data();
+    if (result->count != writes.size() || response.size() - sizeof(PutManyResponse) < result->count) {
+        std::cerr << "Réponse groupée mal formée" << std::endl;
+        return false;
+    }
+    if (status) {
+        status->assign(result->status, result->status + result->count);
+    }
+    return result->stored == result->count;
+}
 
+bool IPCClient::get_stats(GetStatsResponse& stats)
+{
+    uint32_t message_id;
+    IPCResponse response;
+    if (!send_message(nullptr, 0, IPC_ROUTE("stats/get"), &message_id) ||
+        !wait_for_response(response, message_id) ||
+        response.size() < sizeof(GetStatsResponse)) {
+        return false;
+    }
+    memcpy(&stats, response.data(), sizeof(stats));
     return true;
 }
 
+// Attend la fin du traitement d'une requête asynchrone
+static bool wait_processed(std::future<IPCResponse>& reply)
+{
+    try {
+        reply.get();
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Erreur: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 bool IPCClient::test_create_user()
 {
     std::cout << "\n=== TEST CRÉATION UTILISATEUR ===" << std::endl;
@@ -124,15 +565,12 @@ bool IPCClient::test_create_user()
     strncpy(request.username, "john_doe", sizeof(request.username) - 1);
     strncpy(request.email, "john@example.com", sizeof(request.email) - 1);
 
-    std::string route_hash = hash_route("user/create");
+    constexpr uint32_t route_id = IPC_ROUTE("user/create");
 
-    if (send_message(&request, sizeof(request), route_hash)) {
-        std::cout << "Requête de création d'utilisateur envoyée" << std::endl;
-        sleep(1); // Attendre le traitement
-        return true;
-    }
-
-    return false;
+    // Le serveur complète le slot une fois la requête traitée
+    std::future<IPCResponse> reply = send_async(&request, sizeof(request), route_id);
+    std::cout << "Requête de création d'utilisateur envoyée" << std::endl;
+    return wait_processed(reply);
 }
 
 bool IPCClient::test_get_user()
@@ -142,15 +580,12 @@ bool IPCClient::test_get_user()
     GetUserRequest request;
     request.user_id = 123;
 
-    std::string route_hash = hash_route("user/get");
+    constexpr uint32_t route_id = IPC_ROUTE("user/get");
 
-    if (send_message(&request, sizeof(request), route_hash)) {
-        std::cout << "Requête de récupération d'utilisateur envoyée" << std::endl;
-        sleep(1);
-        return true;
-    }
-
-    return false;
+    // Le serveur complète le slot une fois la requête traitée
+    std::future<IPCResponse> reply = send_async(&request, sizeof(request), route_id);
+    std::cout << "Requête de récupération d'utilisateur envoyée" << std::endl;
+    return wait_processed(reply);
 }
 
 bool IPCClient::test_delete_user()
@@ -160,48 +595,95 @@ bool IPCClient::test_delete_user()
     DeleteUserRequest request;
     request.user_id = 456;
 
-    std::string route_hash = hash_route("user/delete");
-
-    if (send_message(&request, sizeof(request), route_hash)) {
-        std::cout << "Requête de suppression d'utilisateur envoyée" << std::endl;
-        sleep(1);
-        return true;
-    }
+    constexpr uint32_t route_id = IPC_ROUTE("user/delete");
 
-    return false;
+    // Le serveur complète le slot une fois la requête traitée
+    std::future<IPCResponse> reply = send_async(&request, sizeof(request), route_id);
+    std::cout << "Requête de suppression d'utilisateur envoyée" << std::endl;
+    return wait_processed(reply);
 }
 
 bool IPCClient::test_add_function_ir()
 {
     std::cout << "\n=== TEST AJOUT FONCTION IR ===" << std::endl;
 
-    // Créer des données de test
-    uint8_t test_data[] = {0x01, 0x02, 0x03, 0x04, 0x05};
-    uint32_t data_size = sizeof(test_data);
+    using namespace v8::internal::compiler;
+
+    // Petit graphe Start -> Parameter -> Return -> End
+    SerializeTFGraph graph;
+    graph.node_start_id = 0;
+    graph.node_end_id = 3;
+    graph.next_node_id = 4;
+    graph.has_simd = false;
+    const char* mnemonics[] = { "Start", "Parameter", "Return", "End" };
+    for (uint32_t id = 0; id < 4; ++id) {
+        SerializeNode node{};
+        node.id = id;
+        node.mnemonic = mnemonics[id];
+        node.opcode = static_cast<uint16_t>(id);
+        if (id > 0) node.inputs.push_back(id - 1);
+        node.input_count = static_cast<int>(node.inputs.size());
+        graph.graph_nodes.emplace(id, node);
+    }
+    std::vector<uint8_t> bytes = GraphSerializer::serialize_to_bytes(graph);
+    uint32_t data_size = static_cast<uint32_t>(bytes.size());
 
     // Calculer la taille totale
     size_t total_size = sizeof(AddFunctionIRRequest) + data_size;
     char* buffer = new char[total_size];
 
     AddFunctionIRRequest* request = (AddFunctionIRRequest*)buffer;
+    memset(request->function_code_hash, 0, sizeof(request->function_code_hash));
     strncpy(request->function_code_hash, "test_function_hash", sizeof(request->function_code_hash) - 1);
     request->serialized_graph_size = data_size;
 
     // Copier les données
-    memcpy(request->serialized_graph, test_data, data_size);
+    memcpy(request->serialized_graph, bytes.data(), data_size);
 
-    std::string route_hash = hash_route("function/add_ir_graph");
+    constexpr uint32_t route_id = IPC_ROUTE("function/add_ir_graph");
 
-    bool result = send_message(buffer, total_size, route_hash);
+    std::future<IPCResponse> reply = send_async(buffer, total_size, route_id);
     delete[] buffer;
 
-    if (result) {
-        std::cout << "Requête d'ajout de fonction IR envoyée" << std::endl;
-        sleep(1);
-        return true;
+    std::cout << "Requête d'ajout de fonction IR envoyée (" << data_size << " octets)" << std::endl;
+    if (!wait_processed(reply)) {
+        return false;
     }
 
-    return false;
+    // Relecture : le graphe est parcouru directement dans la réponse
+    GetFunctionIRGraphRequest get_request;
+    memset(&get_request, 0, sizeof(get_request));
+    strncpy(get_request.function_code_hash, "test_function_hash", sizeof(get_request.function_code_hash) - 1);
+    std::future<IPCResponse> get_reply = send_async(&get_request, sizeof(get_request),
+        IPC_ROUTE("function/get_ir_graph"));
+
+    try {
+        IPCResponse response = get_reply.get();
+        const GetFunctionIRGraphResponse* stored = (const GetFunctionIRGraphResponse*)response.data();
+        if (response.size() < sizeof(GetFunctionIRGraphResponse) || !stored->success ||
+            response.size() < sizeof(GetFunctionIRGraphResponse) + stored->serialized_graph_size) {
+            std::cerr << "Graphe IR non relu" << std::endl;
+            return false;
+        }
+
+        FlatGraphView view;
+        if (!view.open(stored->serialized_graph, stored->serialized_graph_size)) {
+            std::cerr << "Graphe IR relu invalide" << std::endl;
+            return false;
+        }
+        const FlatNode* end = view.find(view.node_end_id());
+        if (view.node_count() != 4 || !end || view.mnemonic(*end) != "End" ||
+            view.inputs(*end).size() != 1 || view.inputs(*end)[0] != 2) {
+            std::cerr << "Graphe IR relu différent de l'original" << std::endl;
+            return false;
+        }
+        std::cout << "Graphe IR relu en place: " << view.node_count() << " nœuds" << std::endl;
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Erreur: " << e.what() << std::endl;
+        return false;
+    }
 }
 
 bool IPCClient::test_get_function_ir()
@@ -211,13 +693,215 @@ bool IPCClient::test_get_function_ir()
     GetFunctionIRRequest request;
     strncpy(request.function_code_hash, "EXISTING_FUNCTION", sizeof(request.function_code_hash) - 1);
 
-    std::string route_hash = hash_route("function/get_ir");
+    constexpr uint32_t route_id = IPC_ROUTE("function/get_ir");
+
+    std::future<IPCResponse> reply = send_async(&request, sizeof(request), route_id);
+    std::cout << "Requête de récupération de fonction IR envoyée" << std::endl;
 
-    if (send_message(&request, sizeof(request), route_hash)) {
-        std::cout << "Requête de récupération de fonction IR envoyée" << std::endl;
-        sleep(1);
+    try {
+        IPCResponse response = reply.get();
+        const GetFunctionIRResponse* ir = (const GetFunctionIRResponse*)response.data();
+        if (response.size() < sizeof(GetFunctionIRResponse) || !ir->success) {
+            std::cerr << "Fonction IR non reçue" << std::endl;
+            return false;
+        }
+        std::cout << "IR reçu: " << ir->bit_array_size << " bits" << std::endl;
         return true;
     }
+    catch (const std::exception& e) {
+        std::cerr << "Erreur: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-    return false;
+bool IPCClient::test_batch_bytecode()
+{
+    std::cout << "\n=== TEST LOT BYTECODE ===" << std::endl;
+
+    // Trois bytecodes écrits en une requête, relus avec une clé absente
+    uint8_t first[] = {0x0b, 0x01};
+    uint8_t second[] = {0x0b, 0x02, 0x02};
+    uint8_t third[] = {0x0b, 0x03, 0x03, 0x03};
+    std::vector<IPCBatchWrite> writes = {
+        {"batch_function_1", first, sizeof(first)},
+        {"batch_function_2", second, sizeof(second)},
+        {"batch_function_3", third, sizeof(third)},
+    };
+    if (!put_many(IPC_ROUTE("bytecode/save_many"), writes)) {
+        std::cerr << "Écriture groupée échouée" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> hashes = {"batch_function_1", "batch_function_missing",
+        "batch_function_2", "batch_function_3"};
+    const IPCBatchWrite* expected[] = {&writes[0], nullptr, &writes[1], &writes[2]};
+    bool intact = true;
+    uint32_t found = 0;
+    bool ok = get_many(IPC_ROUTE("bytecode/get_many"), hashes,
+        [&](size_t i, const uint8_t* data, size_t size) {
+            intact = intact && expected[i] && size == expected[i]->size &&
+                memcmp(data, expected[i]->data, size) == 0;
+        }, &found);
+
+    std::cout << "Lot relu: " << found << "/" << hashes.size() << " bytecodes trouvés" << std::endl;
+    return ok && intact && found == 3;
+}
+
+bool IPCClient::test_pipelined_requests()
+{
+    std::cout << "\n=== TEST REQUÊTES EN VOL ===" << std::endl;
+
+    // Toutes les requêtes partent avant la première réponse
+    GetFunctionIRRequest request;
+    memset(&request, 0, sizeof(request));
+    strncpy(request.function_code_hash, "EXISTING_FUNCTION", sizeof(request.function_code_hash) - 1);
+    constexpr uint32_t route_id = IPC_ROUTE("function/get_ir");
+
+    std::vector<std::future<IPCResponse>> replies;
+    for (int i = 0; i < 32; ++i) {
+        replies.push_back(send_async(&request, sizeof(request), route_id));
+    }
+
+    size_t received = 0;
+    for (auto& reply : replies) {
+        try {
+            IPCResponse response = reply.get();
+            if (response.size() >= sizeof(GetFunctionIRResponse) &&
+                ((const GetFunctionIRResponse*)response.data())->success) {
+                ++received;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Erreur: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << received << "/" << replies.size() << " réponses reçues" << std::endl;
+    return received == replies.size();
+}
+
+// Segments de charge utile (requête ou réponse) encore présents dans /dev/shm
+static int count_external_segments()
+{
+    const std::string prefix = std::string(SHARED_MEM_NAME + 1) + "_";
+    int count = 0;
+    if (DIR* dir = opendir("/dev/shm")) {
+        while (dirent* entry = readdir(dir)) {
+            if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) count++;
+        }
+        closedir(dir);
+    }
+    return count;
+}
+
+bool IPCClient::test_large_bytecode()
+{
+    std::cout << "\n=== TEST GROS BYTECODE ===" << std::endl;
+
+    // Plus grand qu'un slot dans les deux sens : requête et réponse passent
+    // par des segments dédiés
+    const uint32_t bytecode_size = 64 * 1024;
+    std::vector<char> buffer(sizeof(SaveBytecodeRequest) + bytecode_size);
+    SaveBytecodeRequest* request = (SaveBytecodeRequest*)buffer.data();
+    strncpy(request->function_code_hash, "large_bytecode_function", sizeof(request->function_code_hash) - 1);
+    request->bytecode_size = bytecode_size;
+    for (uint32_t i = 0; i < bytecode_size; ++i) {
+        request->bytecode[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    const int segments_before = count_external_segments();
+
+    try {
+        IPCResponse saved = send_async(buffer.data(), buffer.size(), IPC_ROUTE("bytecode/save")).get();
+        const SaveBytecodeResponse* save = (const SaveBytecodeResponse*)saved.data();
+        if (saved.size() < sizeof(SaveBytecodeResponse) || !save->success) {
+            std::cerr << "Gros bytecode non sauvegardé" << std::endl;
+            return false;
+        }
+
+        GetBytecodeRequest get_request;
+        memcpy(get_request.function_code_hash, request->function_code_hash, sizeof(get_request.function_code_hash));
+        IPCResponse read = send_async(&get_request, sizeof(get_request), IPC_ROUTE("bytecode/get")).get();
+        const GetBytecodeResponse* stored = (const GetBytecodeResponse*)read.data();
+        if (read.size() < sizeof(GetBytecodeResponse) || !stored->success ||
+            stored->bytecode_size != bytecode_size ||
+            read.size() < sizeof(GetBytecodeResponse) + bytecode_size ||
+            memcmp(stored->bytecode, request->bytecode, bytecode_size) != 0) {
+            std::cerr << "Gros bytecode relu différent de l'original" << std::endl;
+            return false;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Erreur: " << e.what() << std::endl;
+        return false;
+    }
+
+    // Chaque segment est retiré par son destinataire dès l'ouverture
+    int leftover = count_external_segments() - segments_before;
+    std::cout << "Bytecode de " << bytecode_size << " octets relu à l'identique, "
+        << leftover << " segment(s) restant(s)" << std::endl;
+    return leftover == 0;
+}
+
+bool IPCClient::test_read_cached()
+{
+    std::cout << "\n=== TEST LECTURE PAR RÉFÉRENCE ===" << std::endl;
+
+    uint8_t bytecode[3000];
+    for (uint32_t i = 0; i < sizeof(bytecode); ++i) {
+        bytecode[i] = static_cast<uint8_t>(i * 13 + 1);
+    }
+    std::vector<IPCBatchWrite> writes = {{"ref_function", bytecode, sizeof(bytecode)}};
+    if (!put_many(IPC_ROUTE("bytecode/save_many"), writes)) {
+        std::cerr << "Bytecode non écrit" << std::endl;
+        return false;
+    }
+
+    // Octets lus directement dans le fichier de cache, validés par la génération
+    bool same = false;
+    if (!read_cached(IPC_ROUTE("bytecode/get_ref"), "ref_function",
+            [&](const uint8_t* data, size_t size) {
+                same = size == sizeof(bytecode) && memcmp(data, bytecode, size) == 0;
+            }) || !same) {
+        std::cerr << "Bytecode relu par référence différent de l'original" << std::endl;
+        return false;
+    }
+    if (read_cached(IPC_ROUTE("bytecode/get_ref"), "ref_function_missing",
+            [](const uint8_t*, size_t) {})) {
+        std::cerr << "Clé absente trouvée par référence" << std::endl;
+        return false;
+    }
+
+    // Graphe IR du test d'ajout, parcouru sur place dans le mapping du cache
+    uint32_t nodes = 0;
+    if (!read_cached(IPC_ROUTE("function/get_ir_graph_ref"), "test_function_hash",
+            [&](const uint8_t* data, size_t size) {
+                v8::internal::compiler::FlatGraphView view;
+                nodes = view.open(data, size) ? view.node_count() : 0;
+            }) || nodes == 0) {
+        std::cerr << "Graphe IR non relu par référence" << std::endl;
+        return false;
+    }
+
+    std::cout << "Bytecode de " << sizeof(bytecode) << " octets et graphe de " << nodes
+        << " nœuds relus dans le fichier de cache" << std::endl;
+    return true;
+}
+
+bool IPCClient::test_stats()
+{
+    std::cout << "\n=== TEST MÉTRIQUES ===" << std::endl;
+
+    GetStatsResponse stats;
+    if (!get_stats(stats)) {
+        std::cerr << "Métriques non reçues" << std::endl;
+        return false;
+    }
+
+    // Les tests précédents ont au moins lu la fonction IR
+    const RouteStatsSummary& get_ir = stats.routes[IPC_ROUTE("function/get_ir")];
+    std::cout << "function/get_ir: " << get_ir.count << " requêtes, p50 " << get_ir.p50_ns
+        << " ns, p99 " << get_ir.p99_ns << " ns, max " << get_ir.max_ns << " ns" << std::endl;
+    std::cout << "Cache: " << stats.cache.activity.hits << " lectures trouvées, "
+        << stats.cache.activity.misses << " manquées, " << stats.cache.entry_count << " entrées" << std::endl;
+    return stats.route_count == IPC_ROUTE_COUNT && get_ir.count > 0;
 }
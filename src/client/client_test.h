@@ -2,12 +2,89 @@
 #define CLIENT_TEST_H
 
 #include "../server/common.h"
+#include "../server/trace.h"
+#include "../m_cache/m_cache_reader.h"
+#include <unordered_map>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+// Réponse lue sur place : dans son slot pour une réponse ordinaire, dans
+// son segment dédié pour une grosse réponse. Le slot n'est rendu au pool
+// qu'à la destruction ; à libérer avant IPCClient::disconnect().
+class IPCResponse
+{
+public:
+    IPCResponse() = default;
+    ~IPCResponse();
+    IPCResponse(IPCResponse&& other) noexcept;
+    IPCResponse& operator=(IPCResponse&& other) noexcept;
+    IPCResponse(const IPCResponse&) = delete;
+    IPCResponse& operator=(const IPCResponse&) = delete;
+
+    const char* data() const { return response_data; }
+    size_t size() const { return response_size; }
+    void reset();
+
+private:
+    friend class IPCClient;
+
+    SharedData* shared_data = nullptr;
+    IPCSlot* slot = nullptr;       // Slot à rendre (réponse dans le slot)
+    void* mapping = nullptr;       // Segment à démapper (grosse réponse)
+    const char* response_data = nullptr;
+    size_t response_size = 0;
+};
+
+// Options des requêtes suivantes (IPCClient::set_request_options)
+struct IPCRequestOptions
+{
+    // Au-delà, l'attente échoue et le serveur ignore la requête (0 = sans limite)
+    std::chrono::milliseconds timeout{0};
+    uint32_t priority = IPC_PRIORITY_NORMAL;
+};
+
+// Écriture d'un lot (IPCClient::put_many)
+struct IPCBatchWrite
+{
+    std::string function_code_hash;
+    const uint8_t* data;
+    size_t size;
+};
 
 class IPCClient
 {
 private:
     SharedData* shared_data;
     bool connected;
+    int mailbox;                   // Boîte de réponse prise à la connexion
+    uint32_t mailbox_generation;
+    IPCRequestOptions options;
+
+    // Requête dont la réponse sera lue par wait_for_response
+    struct PendingRequest
+    {
+        uint32_t slot_index;
+        uint64_t deadline_ns;      // ipc_now_ns, 0 = aucune
+    };
+    std::unordered_map<uint32_t, PendingRequest> pending; // message_id -> requête
+    m_cache::SharedCacheReader cache_reader; // Ouvert à la première lecture par référence
+    IPCSpinBudget spin;            // Attente des réponses, ajustée au fil des requêtes
+
+    // Requêtes asynchrones, complétées par un thread dédié au fil des réponses
+    struct AsyncRequest
+    {
+        uint32_t slot_index;
+        uint64_t deadline_ns;
+        std::promise<IPCResponse> promise;
+        uint64_t traced_ns;        // Publication, si IPCTrace est actif
+    };
+    std::mutex async_mutex;
+    std::unordered_map<uint32_t, AsyncRequest> async_pending; // message_id -> requête
+    std::thread completion_thread; // Démarré au premier send_async
+    std::atomic<bool> completion_stop;
 
 public:
     IPCClient();
@@ -16,19 +93,71 @@ public:
     bool connect();
     void disconnect();
 
+    // Échéance et priorité des requêtes envoyées ensuite. Une requête échue
+    // échoue côté client (false, ou std::runtime_error pour un future) et
+    // n'est pas traitée si le serveur ne l'a pas encore prise.
+    void set_request_options(const IPCRequestOptions& request_options) { options = request_options; }
+
     // Méthodes de test pour les différentes fonctionnalités
     bool test_create_user();
     bool test_get_user();
     bool test_delete_user();
     bool test_add_function_ir();
     bool test_get_function_ir();
+    bool test_batch_bytecode();
+    bool test_large_bytecode();
+    bool test_read_cached();
+    bool test_pipelined_requests();
+    bool test_stats();
 
     // Méthodes utilitaires
-    bool send_message(const void* message_data, size_t message_size, const std::string& route_hash);
+    // message_id non nul : la réponse est attendue et doit être lue par wait_for_response.
+    // Au-delà de la capacité d'un slot, la charge utile passe par un segment dédié.
+    bool send_message(const void* message_data, size_t message_size, uint32_t route_id,
+        uint32_t* message_id = nullptr);
+    // Échoue aussi à l'échéance de la requête, ou si le serveur l'a rejetée
+    // (échéance passée, surcharge). Copie dans un buffer de MAX_MESSAGE_SIZE
+    // octets ; échoue pour une réponse plus grande.
     bool wait_for_response(void* response_buffer, size_t& response_size, uint32_t expected_message_id);
+    // Sans copie et sans limite de taille
+    bool wait_for_response(IPCResponse& response, uint32_t expected_message_id);
+
+    // Envoi sans attente : la réponse est livrée dans le future dès son
+    // arrivée, plusieurs requêtes pouvant être en vol. get() lève
+    // std::runtime_error si la requête échoue ou si le client se déconnecte.
+    // À appeler depuis un seul thread, comme send_message.
+    std::future<IPCResponse> send_async(const void* message_data, size_t message_size,
+        uint32_t route_id);
+
+    // Lecture sans copie par une route *_ref : reader reçoit les octets en
+    // place dans le fichier de cache. Si l'entrée est relocalisée pendant la
+    // lecture, la requête est rejouée et reader rappelé ; seul le dernier
+    // appel compte. false si l'entrée est absente.
+    bool read_cached(uint32_t route_id, const char* function_code_hash,
+        const std::function<void(const uint8_t*, size_t)>& reader);
+
+    // Lots, en une requête (routes *_many). reader(i, data, size) est appelé
+    // pour chaque hash i trouvé, data n'étant valable que pendant l'appel ;
+    // found reçoit le nombre de hashes trouvés.
+    bool get_many(uint32_t route_id, const std::vector<std::string>& function_code_hashes,
+        const std::function<void(size_t, const uint8_t*, size_t)>& reader, uint32_t* found = nullptr);
+    // status reçoit un IPC_BATCH_* par écriture, dans l'ordre
+    bool put_many(uint32_t route_id, const std::vector<IPCBatchWrite>& writes,
+        std::vector<uint8_t>* status = nullptr);
+
+    // Métriques du serveur (route stats/get)
+    bool get_stats(GetStatsResponse& stats);
 
 private:
     SharedData* open_shared_memory();
+    // Publie la requête dans un slot ; id et slot retenus par l'appelant
+    bool publish_request(const void* message_data, size_t message_size, uint32_t route_id,
+        bool expects_response, uint64_t deadline_ns, uint32_t* message_id, uint32_t* slot_index);
+    uint64_t request_deadline() const;
+    // Réponse d'un slot complété ; rend le slot si elle n'est pas lue sur place
+    bool take_response(IPCSlot& slot, uint32_t expected_message_id, IPCResponse& response);
+    void completion_loop();
+    void stop_completion();
 };
 
 #endif // CLIENT_TEST_H
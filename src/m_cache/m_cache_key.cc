@@ -0,0 +1,52 @@
+#include "m_cache_key.h"
+#include "picosha2.h"
+
+namespace m_cache {
+
+namespace {
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool DecodeHex(const char* text, size_t length, uint8_t* out) {
+    if (length != CACHE_KEY_SIZE * 2) return false;
+    for (size_t i = 0; i < CACHE_KEY_SIZE; ++i) {
+        int high = HexValue(text[2 * i]);
+        int low = HexValue(text[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        out[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+} // namespace
+
+CacheKey CacheKey::FromString(const char* text, size_t length) {
+    CacheKey key;
+    if (!DecodeHex(text, length, key.bytes)) {
+        picosha2::hash256(text, text + length, key.bytes, key.bytes + CACHE_KEY_SIZE);
+    }
+    return key;
+}
+
+CacheKey CacheKey::FromDigest(const uint8_t* digest) {
+    CacheKey key;
+    memcpy(key.bytes, digest, CACHE_KEY_SIZE);
+    return key;
+}
+
+std::string CacheKey::ToHex() const {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex(CACHE_KEY_SIZE * 2, '0');
+    for (size_t i = 0; i < CACHE_KEY_SIZE; ++i) {
+        hex[2 * i] = kDigits[bytes[i] >> 4];
+        hex[2 * i + 1] = kDigits[bytes[i] & 0xF];
+    }
+    return hex;
+}
+
+} // namespace m_cache
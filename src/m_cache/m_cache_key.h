@@ -0,0 +1,38 @@
+#ifndef M_CACHE_KEY_H_
+#define M_CACHE_KEY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#define CACHE_KEY_SIZE 32
+
+namespace m_cache {
+
+    // Clé binaire de taille fixe : un condensat SHA-256 (ou équivalent)
+    struct CacheKey
+    {
+        uint8_t bytes[CACHE_KEY_SIZE];
+
+        // 64 caractères hexadécimaux : décodés tels quels.
+        // Toute autre chaîne : SHA-256 de son contenu.
+        static CacheKey FromString(const char* text, size_t length);
+        static CacheKey FromString(const std::string& text) {
+            return FromString(text.data(), text.size());
+        }
+        static CacheKey FromDigest(const uint8_t* digest);
+
+        std::string ToHex() const;
+
+        bool operator==(const CacheKey& other) const {
+            return memcmp(bytes, other.bytes, CACHE_KEY_SIZE) == 0;
+        }
+        bool operator!=(const CacheKey& other) const { return !(*this == other); }
+    };
+
+    static_assert(sizeof(CacheKey) == CACHE_KEY_SIZE, "CacheKey doit rester un simple tableau d'octets");
+
+} // namespace m_cache
+
+#endif // M_CACHE_KEY_H_
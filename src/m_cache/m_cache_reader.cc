@@ -0,0 +1,117 @@
+#include "m_cache_reader.h"
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace m_cache {
+
+SharedCacheReader::~SharedCacheReader() {
+    Close();
+}
+
+bool SharedCacheReader::Open(const std::string& path) {
+    Close();
+
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ == -1) {
+        fprintf(stderr, "Failed to open cache file for reading: %s\n", strerror(errno));
+        return false;
+    }
+
+    CacheHeader header;
+    struct stat st;
+    bool valid = pread(fd_, &header, sizeof(header), 0) == sizeof(header) &&
+                 fstat(fd_, &st) == 0 &&
+                 header.magic_number == SharedCache::CACHE_MAGIC &&
+                 header.version == SharedCache::CACHE_VERSION &&
+                 header.max_entries != 0 &&
+                 header.data_offset == CacheLayout::For(header.max_entries).data_offset &&
+                 header.file_size <= header.max_file_size &&
+                 header.file_size <= static_cast<uint64_t>(st.st_size);
+    if (!valid) {
+        fprintf(stderr, "Cache file %s is not initialized\n", path.c_str());
+        Close();
+        return false;
+    }
+
+    // Même principe que SharedCache : réservation jusqu'à max_file_size, le
+    // mapping s'étend sur place et les pointeurs rendus restent valides
+    void* base = mmap(nullptr, header.max_file_size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Failed to reserve cache address space: %s\n", strerror(errno));
+        Close();
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(base);
+    reserved_size_ = header.max_file_size;
+    layout_ = CacheLayout::For(header.max_entries);
+
+    if (!MapUpTo(header.file_size)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedCacheReader::Close() {
+    if (base_) {
+        munmap(base_, reserved_size_);
+        base_ = nullptr;
+    }
+    if (fd_ != -1) {
+        close(fd_);
+        fd_ = -1;
+    }
+    reserved_size_ = 0;
+    mapped_size_ = 0;
+}
+
+bool SharedCacheReader::MapUpTo(uint64_t size) {
+    std::lock_guard<std::mutex> lock(map_mutex_);
+    uint64_t mapped = mapped_size_.load(std::memory_order_relaxed);
+    if (size <= mapped) return true;
+    if (size > reserved_size_) return false;
+
+    void* address = mmap(base_ + mapped, size - mapped, PROT_READ,
+                         MAP_SHARED | MAP_FIXED, fd_, mapped);
+    if (address == MAP_FAILED) {
+        fprintf(stderr, "Failed to extend cache mapping: %s\n", strerror(errno));
+        return false;
+    }
+    mapped_size_.store(size, std::memory_order_release);
+    return true;
+}
+
+const CacheEntryHeader* SharedCacheReader::EntryAt(uint32_t index) const {
+    return reinterpret_cast<const CacheEntryHeader*>(base_ + layout_.entries_offset) + index;
+}
+
+const uint8_t* SharedCacheReader::Data(const CacheRef& ref) {
+    if (!base_ || ref.entry_index >= layout_.max_entries ||
+        ref.offset < layout_.data_offset || ref.offset + ref.length > reserved_size_) {
+        return nullptr;
+    }
+
+    // Le fichier a pu grandir depuis l'ouverture
+    if (ref.offset + ref.length > mapped_size_.load(std::memory_order_acquire)) {
+        const CacheHeader* header = reinterpret_cast<const CacheHeader*>(base_);
+        uint64_t file_size = __atomic_load_n(&header->file_size, __ATOMIC_ACQUIRE);
+        if (ref.offset + ref.length > file_size || !MapUpTo(file_size)) return nullptr;
+    }
+
+    if (__atomic_load_n(&EntryAt(ref.entry_index)->generation, __ATOMIC_ACQUIRE) != ref.generation) {
+        return nullptr;
+    }
+    return base_ + ref.offset;
+}
+
+// Pendant de SharedCache::InvalidateEntry : si une lecture a vu des octets
+// écrits après l'invalidation, la génération relue ici a changé
+bool SharedCacheReader::Validate(const CacheRef& ref) const {
+    if (!base_ || ref.entry_index >= layout_.max_entries) return false;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&EntryAt(ref.entry_index)->generation, __ATOMIC_RELAXED) == ref.generation;
+}
+
+} // namespace m_cache
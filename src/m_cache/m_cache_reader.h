@@ -0,0 +1,48 @@
+#ifndef M_CACHE_READER_H_
+#define M_CACHE_READER_H_
+
+#include <mutex>
+#include "m_v8_shared_cache.h"
+
+namespace m_cache {
+
+    // Lecteur en lecture seule du fichier de cache, pour les processus qui
+    // reçoivent des CacheRef au lieu de copies. Aucun verrou n'est pris :
+    // l'entrée peut être libérée ou réécrite pendant la lecture, et seul
+    // Validate() appelé après la lecture dit si les octets lus sont les bons.
+    //
+    //     const uint8_t* data = reader.Data(ref);
+    //     ... lire data[0, ref.length) ...
+    //     if (!reader.Validate(ref)) { recommencer ou demander une copie }
+    class SharedCacheReader
+    {
+    public:
+        SharedCacheReader() = default;
+        ~SharedCacheReader();
+        SharedCacheReader(const SharedCacheReader&) = delete;
+        SharedCacheReader& operator=(const SharedCacheReader&) = delete;
+
+        bool Open(const std::string& path = CACHE_FILE_PATH);
+        void Close();
+        bool IsOpen() const { return base_ != nullptr; }
+
+        // nullptr si la référence sort du fichier ou est déjà périmée. Le
+        // pointeur reste valide jusqu'à Close(), même si le fichier grandit.
+        const uint8_t* Data(const CacheRef& ref);
+        bool Validate(const CacheRef& ref) const;
+
+    private:
+        bool MapUpTo(uint64_t size);
+        const CacheEntryHeader* EntryAt(uint32_t index) const;
+
+        int fd_ = -1;
+        uint8_t* base_ = nullptr;
+        size_t reserved_size_ = 0;     // Espace d'adresses réservé (max_file_size)
+        std::atomic<uint64_t> mapped_size_{0};
+        CacheLayout layout_;
+        std::mutex map_mutex_;
+    };
+
+} // namespace m_cache
+
+#endif // M_CACHE_READER_H_
@@ -0,0 +1,104 @@
+#include "m_checksum.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define M_CHECKSUM_HAVE_SSE42 1
+#endif
+
+namespace m_cache {
+
+namespace {
+
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78u; // Forme réfléchie
+
+struct Crc32cTables
+{
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPolynomial : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+uint32_t Crc32cSoftware(const uint8_t* data, size_t length, uint32_t crc) {
+    static const Crc32cTables tables;
+    const auto& t = tables.table;
+
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^
+              t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+              t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+              t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef M_CHECKSUM_HAVE_SSE42
+__attribute__((target("sse4.2")))
+uint32_t Crc32cHardware(const uint8_t* data, size_t length, uint32_t crc) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+#else
+    // _mm_crc32_u64 n'existe qu'en 64 bits : mots de 4 octets sur i386
+    while (length >= 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        length -= 4;
+    }
+#endif
+    while (length--) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+using Crc32cFunction = uint32_t (*)(const uint8_t*, size_t, uint32_t);
+
+Crc32cFunction SelectCrc32c() {
+#ifdef M_CHECKSUM_HAVE_SSE42
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Crc32cHardware;
+    }
+#endif
+    return Crc32cSoftware;
+}
+
+} // namespace
+
+uint32_t Crc32c(const uint8_t* data, size_t length, uint32_t crc) {
+    static const Crc32cFunction implementation = SelectCrc32c();
+    return ~implementation(data, length, ~crc);
+}
+
+} // namespace m_cache
@@ -0,0 +1,15 @@
+#ifndef M_CHECKSUM_H_
+#define M_CHECKSUM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace m_cache {
+
+    // CRC32C (Castagnoli). Instruction crc32 de SSE4.2 si le processeur la
+    // fournit, sinon table logicielle slicing-by-8. `crc` permet de chaîner.
+    uint32_t Crc32c(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+} // namespace m_cache
+
+#endif // M_CHECKSUM_H_
@@ -0,0 +1,199 @@
+#include "m_graph_serializer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace v8 {
+namespace internal {
+namespace compiler {
+
+namespace {
+
+constexpr size_t kMaxFlatSize = std::numeric_limits<uint32_t>::max();
+
+uint32_t checked_u32(size_t value, const char* what) {
+  if (value > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(std::string("GraphSerializer: ") + what +
+                            " dépasse 32 bits");
+  }
+  return static_cast<uint32_t>(value);
+}
+
+}  // namespace
+
+bool FlatGraphView::open(const uint8_t* data, size_t size) {
+  *this = FlatGraphView();
+  if (data == nullptr || size < sizeof(FlatGraphHeader) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(FlatNode) != 0) {
+    return false;
+  }
+
+  const FlatGraphHeader* header =
+      reinterpret_cast<const FlatGraphHeader*>(data);
+  if (header->magic != kFlatGraphMagic ||
+      header->version != kFlatGraphVersion || header->total_size != size) {
+    return false;
+  }
+
+  // Sections contiguës : calcul sur 64 bits, pas de débordement possible
+  uint64_t nodes_offset = sizeof(FlatGraphHeader);
+  uint64_t inputs_offset =
+      nodes_offset + uint64_t{header->node_count} * sizeof(FlatNode);
+  uint64_t strings_offset =
+      inputs_offset + uint64_t{header->input_count} * sizeof(uint32_t);
+  if (strings_offset + header->strings_size != size) return false;
+
+  const FlatNode* nodes =
+      reinterpret_cast<const FlatNode*>(data + nodes_offset);
+  const char* strings = reinterpret_cast<const char*>(data + strings_offset);
+  for (uint32_t i = 0; i < header->node_count; ++i) {
+    const FlatNode& node = nodes[i];
+    if (i > 0 && nodes[i - 1].id >= node.id) return false;
+    if (uint64_t{node.inputs_begin} + node.inputs_size > header->input_count) {
+      return false;
+    }
+    // La mnémonique doit rester terminée par '\0' dans la table
+    if (uint64_t{node.mnemonic_offset} + node.mnemonic_length >=
+            header->strings_size ||
+        strings[node.mnemonic_offset + node.mnemonic_length] != '\0') {
+      return false;
+    }
+  }
+
+  header_ = header;
+  nodes_ = nodes;
+  inputs_ = reinterpret_cast<const uint32_t*>(data + inputs_offset);
+  strings_ = strings;
+  return true;
+}
+
+const FlatNode* FlatGraphView::find(uint32_t id) const {
+  const FlatNode* end = nodes_ + node_count();
+  const FlatNode* it = std::lower_bound(
+      nodes_, end, id,
+      [](const FlatNode& node, uint32_t key) { return node.id < key; });
+  return it != end && it->id == id ? it : nullptr;
+}
+
+std::vector<uint8_t> GraphSerializer::serialize_to_bytes(
+    const SerializeTFGraph& graph) {
+  // Ordre par id : recherche dichotomique côté lecteur
+  std::vector<const SerializeNode*> order;
+  order.reserve(graph.graph_nodes.size());
+  for (const auto& pair : graph.graph_nodes) order.push_back(&pair.second);
+  std::sort(order.begin(), order.end(),
+            [](const SerializeNode* a, const SerializeNode* b) {
+              return a->id < b->id;
+            });
+
+  // Mnémoniques dédupliquées : peu d'opérateurs distincts par graphe
+  std::unordered_map<std::string_view, uint32_t> string_offsets;
+  std::string strings;
+  size_t input_count = 0;
+  for (const SerializeNode* node : order) {
+    input_count += node->inputs.size();
+    if (node->mnemonic.size() > std::numeric_limits<uint16_t>::max()) {
+      throw std::length_error("GraphSerializer: mnémonique trop longue");
+    }
+    if (string_offsets.emplace(node->mnemonic, strings.size()).second) {
+      strings.append(node->mnemonic);
+      strings.push_back('\0');
+    }
+  }
+  // Taille totale multiple de 4 : un graphe peut suivre un autre dans un buffer
+  strings.resize((strings.size() + 3) & ~size_t{3}, '\0');
+
+  size_t total_size = sizeof(FlatGraphHeader) + order.size() * sizeof(FlatNode) +
+                      input_count * sizeof(uint32_t) + strings.size();
+  if (total_size > kMaxFlatSize) {
+    throw std::length_error("GraphSerializer: graphe trop volumineux");
+  }
+
+  std::vector<uint8_t> bytes(total_size);
+  FlatGraphHeader header{};
+  header.magic = kFlatGraphMagic;
+  header.version = kFlatGraphVersion;
+  header.flags = graph.has_simd ? kFlatGraphHasSimd : 0;
+  header.total_size = static_cast<uint32_t>(total_size);
+  header.node_count = static_cast<uint32_t>(order.size());
+  header.input_count = static_cast<uint32_t>(input_count);
+  header.strings_size = static_cast<uint32_t>(strings.size());
+  header.node_start_id = graph.node_start_id;
+  header.node_end_id = graph.node_end_id;
+  header.next_node_id = checked_u32(graph.next_node_id, "next_node_id");
+  memcpy(bytes.data(), &header, sizeof(header));
+
+  uint8_t* nodes_out = bytes.data() + sizeof(FlatGraphHeader);
+  uint8_t* inputs_out = nodes_out + order.size() * sizeof(FlatNode);
+  uint32_t inputs_begin = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    const SerializeNode& node = *order[i];
+    FlatNode flat{};
+    flat.id = node.id;
+    flat.opcode = node.opcode;
+    flat.effect_out_ = node.effect_out_;
+    flat.mask = node.mask;
+    flat.value_in_ = node.value_in_;
+    flat.effect_in_ = node.effect_in_;
+    flat.control_in_ = node.control_in_;
+    flat.value_out_ = node.value_out_;
+    flat.control_out_ = node.control_out_;
+    flat.input_count = node.input_count;
+    flat.inputs_begin = inputs_begin;
+    flat.inputs_size = static_cast<uint32_t>(node.inputs.size());
+    flat.mnemonic_offset = string_offsets[node.mnemonic];
+    flat.mnemonic_length = static_cast<uint16_t>(node.mnemonic.size());
+    flat.has_extensible_inputs = node.has_extensible_inputs;
+    memcpy(nodes_out + i * sizeof(FlatNode), &flat, sizeof(flat));
+
+    if (!node.inputs.empty()) {
+      memcpy(inputs_out + size_t{inputs_begin} * sizeof(uint32_t),
+             node.inputs.data(), node.inputs.size() * sizeof(uint32_t));
+    }
+    inputs_begin += flat.inputs_size;
+  }
+  memcpy(inputs_out + input_count * sizeof(uint32_t), strings.data(),
+         strings.size());
+  return bytes;
+}
+
+SerializeTFGraph GraphSerializer::deserialize_from_bytes(const uint8_t* data,
+                                                         size_t data_size) {
+  FlatGraphView view;
+  if (!view.open(data, data_size)) {
+    throw std::runtime_error("GraphSerializer: buffer invalide");
+  }
+
+  SerializeTFGraph graph;
+  graph.node_start_id = view.node_start_id();
+  graph.node_end_id = view.node_end_id();
+  graph.next_node_id = view.next_node_id();
+  graph.has_simd = view.has_simd();
+  graph.graph_nodes.reserve(view.node_count());
+  for (uint32_t i = 0; i < view.node_count(); ++i) {
+    const FlatNode& flat = view.node(i);
+    SerializeNode node;
+    node.id = flat.id;
+    node.mnemonic = std::string(view.mnemonic(flat));
+    node.opcode = flat.opcode;
+    node.value_in_ = flat.value_in_;
+    node.effect_in_ = flat.effect_in_;
+    node.control_in_ = flat.control_in_;
+    node.value_out_ = flat.value_out_;
+    node.effect_out_ = flat.effect_out_;
+    node.control_out_ = flat.control_out_;
+    node.mask = flat.mask;
+    node.input_count = flat.input_count;
+    node.has_extensible_inputs = flat.has_extensible_inputs != 0;
+    FlatInputs inputs = view.inputs(flat);
+    node.inputs.assign(inputs.begin(), inputs.end());
+    graph.graph_nodes.emplace(node.id, std::move(node));
+  }
+  return graph;
+}
+
+}  // namespace compiler
+}  // namespace internal
+}  // namespace v8
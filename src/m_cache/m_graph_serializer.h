@@ -1,9 +1,11 @@
 #ifndef M_GRAPH_SERIALIZER_H_
 #define M_GRAPH_SERIALIZER_H_
+#include <cstdint>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace v8 {
 namespace internal {
@@ -74,31 +76,106 @@ struct SerializeTFGraph {
   // Chaque nœud est sérialisé avec SerializedNode
   std::unordered_map<uint32_t, SerializeNode> graph_nodes;
 };
-// ...existing code...
+// Format plat du graphe sérialisé : lu sur place (mmap du cache, slot IPC)
+// sans reconstruire de map ni allouer par nœud. Tous les champs sont alignés
+// sur 4 octets, la charge utile d'une requête IPC n'en garantit pas plus.
+//
+//   FlatGraphHeader | FlatNode[node_count] (triés par id)
+//   | uint32_t inputs[input_count] | mnémoniques terminées par '\0'
+constexpr uint32_t kFlatGraphMagic = 0x52474654;  // "TFGR"
+constexpr uint16_t kFlatGraphVersion = 1;
+constexpr uint16_t kFlatGraphHasSimd = 0x1;
+
+struct FlatGraphHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;           // kFlatGraph*
+  uint32_t total_size;      // Taille du buffer entier
+  uint32_t node_count;
+  uint32_t input_count;     // Taille du tableau des inputs, tous nœuds confondus
+  uint32_t strings_size;    // Taille de la table des mnémoniques
+  uint32_t node_start_id;
+  uint32_t node_end_id;
+  uint32_t next_node_id;
+  uint32_t reserved;
+};
+
+struct FlatNode {
+  uint32_t id;
+  uint16_t opcode;
+  uint8_t effect_out_;
+  uint8_t mask;
+  uint32_t value_in_;
+  uint32_t effect_in_;
+  uint32_t control_in_;
+  uint32_t value_out_;
+  uint32_t control_out_;
+  int32_t input_count;
+  uint32_t inputs_begin;    // Indice du premier input dans le tableau commun
+  uint32_t inputs_size;
+  uint32_t mnemonic_offset; // Dans la table des mnémoniques
+  uint16_t mnemonic_length;
+  uint8_t has_extensible_inputs;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(FlatGraphHeader) == 40, "FlatGraphHeader : disposition figée");
+static_assert(sizeof(FlatNode) == 48, "FlatNode : disposition figée");
+
+// Plage d'ids d'inputs, lue en place
+struct FlatInputs {
+  const uint32_t* first;
+  uint32_t count;
+
+  const uint32_t* begin() const { return first; }
+  const uint32_t* end() const { return first + count; }
+  uint32_t size() const { return count; }
+  uint32_t operator[](uint32_t i) const { return first[i]; }
+};
+
+// Vue typée sur un graphe sérialisé. Ne copie rien : le buffer doit rester
+// valide (et inchangé) tant que la vue est utilisée.
+class FlatGraphView {
+ public:
+  FlatGraphView() = default;
+
+  // Vérifie bornes, alignement et cohérence du buffer ; false s'il n'est pas
+  // un graphe valide, la vue restant alors vide
+  bool open(const uint8_t* data, size_t size);
+
+  uint32_t node_count() const { return header_ ? header_->node_count : 0; }
+  uint32_t node_start_id() const { return header_->node_start_id; }
+  uint32_t node_end_id() const { return header_->node_end_id; }
+  uint32_t next_node_id() const { return header_->next_node_id; }
+  bool has_simd() const { return header_->flags & kFlatGraphHasSimd; }
+
+  const FlatNode& node(uint32_t index) const { return nodes_[index]; }
+  // Recherche dichotomique ; nullptr si l'id est absent
+  const FlatNode* find(uint32_t id) const;
+  FlatInputs inputs(const FlatNode& node) const {
+    return FlatInputs{inputs_ + node.inputs_begin, node.inputs_size};
+  }
+  std::string_view mnemonic(const FlatNode& node) const {
+    return std::string_view(strings_ + node.mnemonic_offset, node.mnemonic_length);
+  }
+
+ private:
+  const FlatGraphHeader* header_ = nullptr;
+  const FlatNode* nodes_ = nullptr;
+  const uint32_t* inputs_ = nullptr;
+  const char* strings_ = nullptr;
+};
 
-// Nouvelles fonctions de sérialisation
 class GraphSerializer {
  public:
-  // Sérialiser SerializeTFGraph vers un buffer de uint8_t
+  // Sérialiser SerializeTFGraph au format plat ; std::length_error si le
+  // graphe dépasse les limites du format (tailles sur 32 bits)
   static std::vector<uint8_t> serialize_to_bytes(const SerializeTFGraph& graph);
 
-  // Désérialiser depuis un buffer de uint8_t vers SerializeTFGraph
+  // Reconstruire SerializeTFGraph (copie complète) ; préférer FlatGraphView
+  // pour lire sans allouer. std::runtime_error si le buffer est invalide.
   static SerializeTFGraph deserialize_from_bytes(const uint8_t* data,
                                                  size_t data_size);
-
- private:
-  // Helpers pour la sérialisation
-  static void write_uint32(std::vector<uint8_t>& buffer, uint32_t value);
-  static void write_string(std::vector<uint8_t>& buffer,
-                           const std::string& str);
-  static void write_serialize_node(std::vector<uint8_t>& buffer,
-                                   const SerializeNode& node);
-
-  // Helpers pour la désérialisation
-  static uint32_t read_uint32(const uint8_t*& data, size_t& remaining);
-  static std::string read_string(const uint8_t*& data, size_t& remaining);
-  static SerializeNode read_serialize_node(const uint8_t*& data,
-                                           size_t& remaining);
 };
 
 }  // namespace compiler
@@ -0,0 +1,192 @@
+#include "m_shared_lock.h"
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace m_cache {
+
+namespace {
+
+// Délai au-delà duquel un processus en attente vérifie si le détenteur est mort
+const timespec kLivenessCheckInterval = {0, 5 * 1000 * 1000};
+
+} // namespace
+
+int FutexWait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+                   expected, timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE,
+            count, nullptr, nullptr, 0);
+}
+
+bool SharedRwLock::Initialize(SharedRwLockState* state) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int rc = pthread_mutex_init(&state->writer, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to initialize shared lock: %s\n", strerror(rc));
+        return false;
+    }
+
+    state->writer_active.store(0);
+    state->drain_seq.store(0);
+    state->needs_recovery.store(0);
+    for (SharedReaderSlot& slot : state->readers) {
+        slot.pid.store(0);
+        slot.count.store(0);
+    }
+    return true;
+}
+
+void SharedRwLock::Attach(SharedRwLockState* state) {
+    state_ = state;
+    slot_ = nullptr;
+
+    const int32_t self = getpid();
+    for (SharedReaderSlot& slot : state_->readers) {
+        if (slot.pid.load() == self) {
+            slot_ = &slot;
+            return;
+        }
+    }
+    for (SharedReaderSlot& slot : state_->readers) {
+        int32_t owner = slot.pid.load();
+        if (owner != 0 && IsAlive(owner)) continue;
+        if (slot.pid.compare_exchange_strong(owner, self)) {
+            slot.count.store(0);
+            slot_ = &slot;
+            return;
+        }
+    }
+    fprintf(stderr, "No reader slot available, readers will be serialized\n");
+}
+
+void SharedRwLock::Detach() {
+    if (slot_) {
+        slot_->count.store(0);
+        slot_->pid.store(0);
+        slot_ = nullptr;
+    }
+    state_ = nullptr;
+}
+
+bool SharedRwLock::HasOtherProcesses() const {
+    const int32_t self = getpid();
+    for (const SharedReaderSlot& slot : state_->readers) {
+        int32_t owner = slot.pid.load();
+        if (owner != 0 && owner != self && IsAlive(owner)) return true;
+    }
+    return false;
+}
+
+bool SharedRwLock::IsAlive(int32_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+bool SharedRwLock::Lock() {
+    int rc = pthread_mutex_lock(&state_->writer);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&state_->writer);
+        state_->needs_recovery.store(1);
+    }
+
+    state_->writer_active.store(1);
+    WaitForReaders();
+    return state_->needs_recovery.exchange(0) != 0;
+}
+
+void SharedRwLock::Unlock() {
+    state_->writer_active.store(0);
+    FutexWake(&state_->writer_active, INT_MAX);
+    pthread_mutex_unlock(&state_->writer);
+}
+
+bool SharedRwLock::LockShared() {
+    if (!slot_) {
+        if (Lock()) {
+            state_->needs_recovery.store(1);
+            Unlock();
+            return false;
+        }
+        return true;
+    }
+
+    for (;;) {
+        slot_->count.fetch_add(1);
+        if (state_->writer_active.load() == 0) {
+            if (state_->needs_recovery.load() == 0) return true;
+            UnlockShared();
+            return false;
+        }
+
+        UnlockShared();
+        if (FutexWait(&state_->writer_active, 1, &kLivenessCheckInterval) == -1 &&
+            errno == ETIMEDOUT) {
+            CheckDeadWriter();
+        }
+    }
+}
+
+void SharedRwLock::UnlockShared() {
+    if (!slot_) {
+        Unlock();
+        return;
+    }
+
+    slot_->count.fetch_sub(1);
+    if (state_->writer_active.load() != 0) {
+        state_->drain_seq.fetch_add(1);
+        FutexWake(&state_->drain_seq, INT_MAX);
+    }
+}
+
+// Un lecteur bloqué trop longtemps vérifie que l'écrivain est toujours vivant
+void SharedRwLock::CheckDeadWriter() {
+    int rc = pthread_mutex_trylock(&state_->writer);
+    if (rc == EBUSY) return;
+
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&state_->writer);
+        state_->needs_recovery.store(1);
+    }
+    // Mutex obtenu : aucun écrivain vivant ne peut avoir posé writer_active
+    if (rc == 0 || rc == EOWNERDEAD) {
+        state_->writer_active.store(0);
+        FutexWake(&state_->writer_active, INT_MAX);
+        pthread_mutex_unlock(&state_->writer);
+    }
+}
+
+void SharedRwLock::WaitForReaders() {
+    for (;;) {
+        uint32_t seq = state_->drain_seq.load();
+        bool busy = false;
+        for (SharedReaderSlot& slot : state_->readers) {
+            if (slot.count.load() == 0) continue;
+
+            int32_t owner = slot.pid.load();
+            if (owner != 0 && !IsAlive(owner)) {
+                // Lecteurs d'un processus disparu : le slot est récupéré
+                slot.count.store(0);
+                slot.pid.compare_exchange_strong(owner, 0);
+                continue;
+            }
+            busy = true;
+        }
+        if (!busy) return;
+        FutexWait(&state_->drain_seq, seq, &kLivenessCheckInterval);
+    }
+}
+
+} // namespace m_cache
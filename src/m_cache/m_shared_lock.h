@@ -0,0 +1,70 @@
+#ifndef M_SHARED_LOCK_H_
+#define M_SHARED_LOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define SHARED_LOCK_READER_SLOTS 64
+
+namespace m_cache {
+
+    // Attente/réveil futex sur un mot en mémoire partagée (pas de FUTEX_PRIVATE_FLAG)
+    int FutexWait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout);
+    void FutexWake(std::atomic<uint32_t>* word, int count);
+
+    // Compteur de lecteurs d'un processus (tous ses threads le partagent)
+    struct alignas(64) SharedReaderSlot
+    {
+        std::atomic<int32_t> pid;          // 0 = libre
+        std::atomic<uint32_t> count;       // Lecteurs actifs de ce processus
+    };
+
+    // État du verrou, placé tel quel dans la région mmap partagée
+    struct SharedRwLockState
+    {
+        pthread_mutex_t writer;            // Robuste et partagé entre processus
+        alignas(64) std::atomic<uint32_t> writer_active; // 1 tant qu'un écrivain est entré
+        std::atomic<uint32_t> drain_seq;   // Incrémenté quand un lecteur sort pendant une écriture
+        std::atomic<uint32_t> needs_recovery; // Un écrivain est mort en section critique
+        SharedReaderSlot readers[SHARED_LOCK_READER_SLOTS];
+    };
+
+    // Verrou lecteurs/écrivain entre processus. Les écrivains passent par un
+    // mutex robuste : si le détenteur meurt, Lock() retourne true au suivant,
+    // qui doit remettre les structures protégées en état avant Unlock().
+    // Les lecteurs s'annoncent dans le slot de leur processus ; un slot dont le
+    // processus a disparu est ignoré par les écrivains.
+    class SharedRwLock
+    {
+    public:
+        // À appeler une seule fois, à la création de la région
+        static bool Initialize(SharedRwLockState* state);
+
+        // Rattache le processus courant à un état existant
+        void Attach(SharedRwLockState* state);
+        void Detach();
+
+        bool Lock();              // true : les structures protégées sont à réparer
+        void Unlock();
+        bool LockShared();        // false : réparation nécessaire, passer par Lock()
+        void UnlockShared();
+
+        // Un autre processus vivant occupe un slot de lecteur (les processus
+        // sans slot, au-delà de SHARED_LOCK_READER_SLOTS, ne sont pas vus)
+        bool HasOtherProcesses() const;
+
+    private:
+        static bool IsAlive(int32_t pid);
+        void WaitForReaders();
+        void CheckDeadWriter();
+
+        SharedRwLockState* state_ = nullptr;
+        SharedReaderSlot* slot_ = nullptr;   // nullptr : lecteurs sérialisés comme écrivains
+    };
+
+} // namespace m_cache
+
+#endif // M_SHARED_LOCK_H_
@@ -1,17 +1,122 @@
 #include "m_v8_shared_cache.h"
+#include "m_checksum.h"
 #include <iostream>
 #include <cstdio>
 #include <cerrno>
 #include <algorithm>
+#include <sys/file.h>
+#include <sys/stat.h>
 
 namespace m_cache {
 
+namespace {
+
+constexpr uint32_t kMaxEntriesLimit = 1u << 24;             // Garde index et sketch sur 32 bits
+
+constexpr uint8_t kSketchMax = 15;                           // Compteurs sur 4 bits
+constexpr uint32_t kSketchResetFactor = 10;                  // Fenêtre de vieillissement, en capacités
+constexpr uint32_t kLfuSampleSize = 8;
+constexpr uint32_t kSketchSeeds[CACHE_SKETCH_ROWS] = {
+    0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu
+};
+
+inline uint32_t SketchColumn(uint32_t hash, uint32_t row, uint32_t width) {
+    uint32_t h = (hash ^ (hash >> 16)) * kSketchSeeds[row];
+    return (h ^ (h >> 15)) & (width - 1);
+}
+
+constexpr size_t kPageSize = 4096;
+
+constexpr uint64_t kBlockAlign = 16;
+constexpr uint64_t kBlockHeaderSize = sizeof(CacheBlockHeader);
+constexpr uint64_t kMinBlockSize = 48; // en-tête + CacheFreeLink
+
+static_assert(kBlockHeaderSize % kBlockAlign == 0, "En-tête de bloc mal aligné");
+static_assert(kMinBlockSize >= kBlockHeaderSize + sizeof(CacheFreeLink),
+              "Un bloc libre doit pouvoir contenir son chaînage");
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+inline uint32_t NextPowerOfTwo(uint32_t value) {
+    return value <= 1 ? 1 : 1u << (32 - __builtin_clz(value - 1));
+}
+
+inline uint64_t BlockSizeFor(uint32_t length) {
+    return std::max(AlignUp(static_cast<uint64_t>(length) + kBlockHeaderSize, kBlockAlign),
+                    kMinBlockSize);
+}
+
+inline uint32_t SizeClass(uint64_t size) {
+    return 63 - __builtin_clzll(size);
+}
+
+} // namespace
+
+CacheLayout CacheLayout::For(uint32_t max_entries) {
+    CacheLayout layout;
+    layout.max_entries = std::min(std::max(max_entries, 1u), kMaxEntriesLimit);
+    // Au moins une case vide dans l'index, toujours
+    layout.index_buckets = NextPowerOfTwo(layout.max_entries * 2);
+    layout.sketch_width = NextPowerOfTwo(layout.max_entries * 4);
+    layout.bitmap_words = (layout.max_entries + 63) / 64;
+
+    layout.index_offset = sizeof(CacheHeader);
+    layout.bitmap_offset = layout.index_offset + sizeof(CacheIndexSlot) *
+                           static_cast<uint64_t>(layout.index_buckets) * CACHE_NAMESPACES;
+    layout.sketch_offset = layout.bitmap_offset + sizeof(uint64_t) * layout.bitmap_words;
+    layout.entries_offset = AlignUp(layout.sketch_offset +
+                                    static_cast<uint64_t>(CACHE_SKETCH_ROWS) * layout.sketch_width,
+                                    alignof(CacheEntryHeader));
+    layout.data_offset = AlignUp(layout.entries_offset +
+                                 sizeof(CacheEntryHeader) * static_cast<uint64_t>(layout.max_entries),
+                                 kBlockAlign);
+    return layout;
+}
+
+CacheHandle::~CacheHandle() {
+    Release();
+}
+
+CacheHandle::CacheHandle(CacheHandle&& other) noexcept
+    : cache_(other.cache_), entry_index_(other.entry_index_),
+      data_(other.data_), length_(other.length_) {
+    other.cache_ = nullptr;
+}
+
+CacheHandle& CacheHandle::operator=(CacheHandle&& other) noexcept {
+    if (this != &other) {
+        Release();
+        cache_ = other.cache_;
+        entry_index_ = other.entry_index_;
+        data_ = other.data_;
+        length_ = other.length_;
+        other.cache_ = nullptr;
+    }
+    return *this;
+}
+
+void CacheHandle::Release() {
+    if (cache_) {
+        cache_->Unpin(entry_index_);
+        cache_ = nullptr;
+        data_ = nullptr;
+        length_ = 0;
+    }
+}
+
 SharedCache::SharedCache() = default;
 
 SharedCache::~SharedCache() {
+    StopScrubber();
+    StopFlusher();
     if (mmap_base_ != nullptr && mmap_base_ != MAP_FAILED) {
-        msync(mmap_base_, mmap_size_, MS_SYNC);
-        munmap(mmap_base_, mmap_size_);
+        if (durability_mode_ != DurabilityMode::kNone) {
+            SyncPages(pending_pages_);
+        }
+        lock_.Detach();
+        munmap(mmap_base_, reserved_size_);
     }
     if (fd_ != -1) {
         close(fd_);
@@ -20,6 +125,8 @@ SharedCache::~SharedCache() {
 
 // CHANGEMENT : Ajouter const à la signature
 void SharedCache::EnsureInitialized() const {
+    if (initialized_.load(std::memory_order_acquire)) return;
+
     std::lock_guard<std::mutex> lock(mutex_);
     if (!initialized_) {
         if (InitMmap()) {
@@ -30,53 +137,366 @@ void SharedCache::EnsureInitialized() const {
     }
 }
 
+bool SharedCache::Configure(const CacheConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (initialized_) {
+        fprintf(stderr, "SharedCache already opened, configuration ignored\n");
+        return false;
+    }
+    config_ = config;
+    configured_ = true;
+    return true;
+}
+
+// Le fichier n'est mappé que jusqu'à sa taille actuelle, à l'intérieur d'une
+// réservation PROT_NONE de max_file_size : la croissance se fait en place,
+// les pointeurs (et les CacheHandle) restent valides.
 // CHANGEMENT : Ajouter const à la signature
 bool SharedCache::InitMmap() const {
-    fd_ = open(CACHE_FILE_PATH, O_RDWR | O_CREAT, 0666);
+    fd_ = open(config_.path.c_str(), O_RDWR | O_CREAT, 0666);
     if (fd_ == -1) {
         fprintf(stderr, "Failed to open cache file: %s\n", strerror(errno));
         return false;
     }
 
-    if (ftruncate(fd_, CACHE_FILE_SIZE) == -1) {
-        fprintf(stderr, "Failed to truncate cache file: %s\n", strerror(errno));
+    // flock sérialise la création entre processus et se libère si l'un d'eux meurt
+    flock(fd_, LOCK_EX);
+
+    // Un fichier valide impose ses dimensions, quelle que soit la configuration
+    CacheHeader existing;
+    struct stat st;
+    bool reuse = pread(fd_, &existing, sizeof(existing), 0) == sizeof(existing) &&
+                 fstat(fd_, &st) == 0 &&
+                 existing.magic_number == CACHE_MAGIC && existing.version == CACHE_VERSION &&
+                 existing.max_entries != 0 &&
+                 existing.data_offset == CacheLayout::For(existing.max_entries).data_offset &&
+                 existing.file_size <= existing.max_file_size &&
+                 existing.file_size <= static_cast<uint64_t>(st.st_size);
+
+    uint64_t file_size = 0;
+    uint64_t max_size = 0;
+    if (reuse) {
+        layout_ = CacheLayout::For(existing.max_entries);
+        file_size = existing.file_size;
+        max_size = existing.max_file_size;
+        if (configured_ && (existing.max_entries != config_.max_entries ||
+                            max_size != AlignUp(config_.max_size, kPageSize))) {
+            fprintf(stderr, "Existing cache file kept: %u entries, up to %llu bytes\n",
+                    existing.max_entries, static_cast<unsigned long long>(max_size));
+        }
+    } else {
+        layout_ = CacheLayout::For(config_.max_entries);
+        file_size = AlignUp(std::max(config_.initial_size, layout_.data_offset + kMinBlockSize), kPageSize);
+        max_size = std::max(AlignUp(config_.max_size, kPageSize), file_size);
+        if (ftruncate(fd_, file_size) == -1) {
+            fprintf(stderr, "Failed to truncate cache file: %s\n", strerror(errno));
+            flock(fd_, LOCK_UN);
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+
+    mmap_base_ = mmap(nullptr, max_size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mmap_base_ == MAP_FAILED) {
+        fprintf(stderr, "Failed to reserve cache address space: %s\n", strerror(errno));
+        flock(fd_, LOCK_UN);
         close(fd_);
         fd_ = -1;
+        mmap_base_ = nullptr;
         return false;
     }
+    reserved_size_ = max_size;
+    mapped_size_ = 0;
 
-    mmap_base_ = mmap(nullptr, CACHE_FILE_SIZE, PROT_READ | PROT_WRITE,
-                      MAP_SHARED, fd_, 0);
-    if (mmap_base_ == MAP_FAILED) {
-        fprintf(stderr, "Failed to mmap cache file: %s\n", strerror(errno));
+    bool ok = MapUpTo(file_size);
+
+    const size_t page_count = max_size / kPageSize;
+    dirty_pages_.Reset(page_count);
+    pending_pages_.Reset(page_count);
+    verified_.reset(new std::atomic<uint32_t>[layout_.max_entries]());
+
+    CacheHeader* header = GetHeader();
+    if (ok && !reuse) {
+        header->magic_number = 0;
+        ok = SharedRwLock::Initialize(&header->lock);
+        if (ok) {
+            header->max_entries = layout_.max_entries;
+            header->data_offset = layout_.data_offset;
+            header->file_size = file_size;
+            header->max_file_size = max_size;
+            for (uint32_t n = 0; n < CACHE_NAMESPACES; ++n) {
+                const uint64_t share = std::min(config_.namespace_share[n], 100u);
+                header->namespaces[n].budget_bytes = max_size / 100 * share;
+                header->namespaces[n].max_entries =
+                    std::max(1u, static_cast<uint32_t>(layout_.max_entries * share / 100));
+            }
+            InitializeCache();
+        }
+    }
+    if (ok) {
+        lock_.Attach(&header->lock);
+        // Premier processus sur un fichier existant : les épinglages laissés
+        // par un processus mort ne tiennent plus aucun CacheHandle
+        if (reuse && !lock_.HasOtherProcesses()) {
+            WriteLock lock(this);
+            ClearStalePins();
+            CommitDirty();
+        }
+    }
+    flock(fd_, LOCK_UN);
+
+    if (!ok) {
+        munmap(mmap_base_, reserved_size_);
+        mmap_base_ = nullptr;
         close(fd_);
         fd_ = -1;
-        mmap_base_ = nullptr;
+    }
+    return ok;
+}
+
+// Étend le mapping de ce processus ; appelé sous le verrou du cache
+bool SharedCache::MapUpTo(uint64_t size) const {
+    std::lock_guard<std::mutex> lock(map_mutex_);
+    uint64_t mapped = mapped_size_.load(std::memory_order_relaxed);
+    if (size <= mapped) return true;
+    if (size > reserved_size_) {
+        fprintf(stderr, "Cache file larger than reserved address space\n");
         return false;
     }
 
-    mmap_size_ = CACHE_FILE_SIZE;
+    void* address = mmap(static_cast<uint8_t*>(mmap_base_) + mapped, size - mapped,
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_, mapped);
+    if (address == MAP_FAILED) {
+        fprintf(stderr, "Failed to extend cache mapping: %s\n", strerror(errno));
+        return false;
+    }
+    mapped_size_.store(size, std::memory_order_release);
+    return true;
+}
 
+// Un autre processus a pu agrandir le fichier depuis notre dernier accès
+void SharedCache::SyncMapping() const {
+    uint64_t size = __atomic_load_n(&GetHeader()->file_size, __ATOMIC_ACQUIRE);
+    if (size > mapped_size_.load(std::memory_order_acquire)) {
+        MapUpTo(size);
+    }
+}
+
+// Double la taille du fichier (au moins `required`), sans dépasser max_file_size.
+// Sous verrou d'écriture.
+bool SharedCache::GrowFile(uint64_t required) const {
     CacheHeader* header = GetHeader();
-    if (header->magic_number != CACHE_MAGIC || header->version != CACHE_VERSION) {
-        InitializeCache();
+    if (required > header->max_file_size) return false;
+
+    uint64_t size = std::max(AlignUp(required, kPageSize),
+                             std::min(header->file_size * 2, header->max_file_size));
+    if (ftruncate(fd_, size) == -1) {
+        fprintf(stderr, "Failed to grow cache file: %s\n", strerror(errno));
+        return false;
     }
+    if (!MapUpTo(size)) return false;
 
+    __atomic_store_n(&header->file_size, size, __ATOMIC_RELEASE);
+    MarkDirty(header, sizeof(CacheHeader));
+    Count(kFileGrows);
     return true;
 }
 
 // CHANGEMENT : Ajouter const à la signature
 void SharedCache::InitializeCache() const {
     CacheHeader* header = GetHeader();
-    header->magic_number = CACHE_MAGIC;
-    header->version = CACHE_VERSION;
     header->entry_count = 0;
-    header->next_offset = sizeof(CacheHeader) + sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES;
+    header->next_offset = layout_.data_offset;
+    header->last_block = 0;
+    header->free_bytes = 0;
+    memset(header->free_lists, 0, sizeof(header->free_lists));
+    for (CacheNamespaceState& state : header->namespaces) {
+        state.used_bytes = 0;
+        state.entry_count = 0;
+        state.clock_hand = 0;
+    }
+    header->sketch_additions = 0;
 
+    CacheIndexSlot* index = GetIndex(0);
+    for (uint32_t i = 0; i < layout_.index_buckets * CACHE_NAMESPACES; ++i) {
+        index[i].key_hash = 0;
+        index[i].entry_index = INDEX_EMPTY;
+    }
+    memset(GetFreeBitmap(), 0, sizeof(uint64_t) * layout_.bitmap_words);
+    memset(GetSketch(), 0, static_cast<size_t>(CACHE_SKETCH_ROWS) * layout_.sketch_width);
+
+    // Les générations survivent : une vérification mémorisée ne doit pas
+    // s'appliquer au prochain contenu du slot
     CacheEntryHeader* entries = GetEntries();
-    memset(entries, 0, sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES);
+    for (uint32_t i = 0; i < layout_.max_entries; ++i) {
+        uint32_t generation = entries[i].generation;
+        memset(&entries[i], 0, sizeof(CacheEntryHeader));
+        entries[i].generation = generation + 1;
+    }
+
+    // Le magic en dernier : un fichier à moitié initialisé sera réinitialisé
+    header->version = CACHE_VERSION;
+    header->magic_number = CACHE_MAGIC;
+
+    msync(mmap_base_, layout_.data_offset, MS_SYNC);
+}
+
+SharedCache::WriteLock::WriteLock(const SharedCache* cache) : cache_(cache) {
+    uint64_t start = cache_->TraceStart();
+    bool needs_recovery = cache_->lock_.Lock();
+    cache_->TraceEnd("cache.write_lock", start);
+    cache_->SyncMapping();
+    if (needs_recovery) {
+        cache_->RecoverLocked();
+    }
+}
+
+SharedCache::WriteLock::~WriteLock() {
+    cache_->lock_.Unlock();
+}
+
+SharedCache::ReadLock::ReadLock(const SharedCache* cache) : cache_(cache) {
+    uint64_t start = cache_->TraceStart();
+    while (!cache_->lock_.LockShared()) {
+        WriteLock repair(cache_);
+    }
+    cache_->TraceEnd("cache.read_lock", start);
+    cache_->SyncMapping();
+}
+
+SharedCache::ReadLock::~ReadLock() {
+    cache_->lock_.UnlockShared();
+}
+
+// Un écrivain est mort en pleine modification : on vérifie la chaîne de blocs,
+// puis on reconstruit listes libres, index et bitmap à partir des entrées.
+// Si la chaîne est incohérente, le cache est simplement vidé.
+void SharedCache::RecoverLocked() const {
+    fprintf(stderr, "Previous cache writer died, recovering\n");
+
+    CacheHeader* header = GetHeader();
+    bool consistent = header->next_offset >= layout_.data_offset &&
+                      header->next_offset <= header->file_size &&
+                      header->file_size <= mapped_size_.load(std::memory_order_relaxed);
+
+    std::vector<uint64_t> blocks;
+    uint64_t prev_size = 0;
+    for (uint64_t off = layout_.data_offset; consistent && off < header->next_offset;) {
+        CacheBlockHeader* block = BlockAt(off);
+        if (block->size < kMinBlockSize || block->size % kBlockAlign != 0 ||
+            block->size > header->next_offset - off || block->prev_size != prev_size) {
+            consistent = false;
+            break;
+        }
+        blocks.push_back(off);
+        prev_size = block->size;
+        off += block->size;
+    }
+
+    if (!consistent) {
+        fprintf(stderr, "Cache block chain corrupted, clearing cache\n");
+        InitializeCache();
+        return;
+    }
+
+    header->last_block = blocks.empty() ? 0 : blocks.back();
+    header->free_bytes = 0;
+    memset(header->free_lists, 0, sizeof(header->free_lists));
+
+    CacheIndexSlot* index = GetIndex(0);
+    for (uint32_t i = 0; i < layout_.index_buckets * CACHE_NAMESPACES; ++i) {
+        index[i].key_hash = 0;
+        index[i].entry_index = INDEX_EMPTY;
+    }
+    memset(GetFreeBitmap(), 0, sizeof(uint64_t) * layout_.bitmap_words);
+    header->entry_count = 0;
+    for (CacheNamespaceState& state : header->namespaces) {
+        state.used_bytes = 0;
+        state.entry_count = 0;
+        state.clock_hand = 0;
+    }
 
-    msync(mmap_base_, mmap_size_, MS_SYNC);
+    // Entrées valides : bloc occupé appartenant à la chaîne, assez grand, clé unique
+    std::vector<uint64_t> owned;
+    for (uint32_t i = 0; i < layout_.max_entries; ++i) {
+        CacheEntryHeader* entry = EntryAt(i);
+        if (!entry->is_used) continue;
+
+        uint64_t block = entry->offset - kBlockHeaderSize;
+        bool valid = entry->ns < CACHE_NAMESPACES &&
+                     entry->offset >= layout_.data_offset + kBlockHeaderSize &&
+                     std::binary_search(blocks.begin(), blocks.end(), block) &&
+                     !BlockAt(block)->is_free &&
+                     BlockAt(block)->size >= BlockSizeFor(entry->length) &&
+                     !std::binary_search(owned.begin(), owned.end(), block);
+        if (valid && !entry->retired &&
+            FindEntry(entry->ns, entry->key, HashKey(entry->key)) != -1) {
+            valid = false;
+        }
+
+        if (!valid) {
+            uint32_t generation = entry->generation;
+            memset(entry, 0, sizeof(CacheEntryHeader));
+            entry->generation = generation + 1;
+            continue;
+        }
+        // Une entrée retirée reste hors de l'index jusqu'au dernier Unpin
+        entry->key_hash = HashKey(entry->key);
+        CacheNamespaceState& state = header->namespaces[entry->ns];
+        if (!entry->retired) {
+            IndexInsert(entry->ns, entry->key_hash, i);
+            header->entry_count++;
+            state.entry_count++;
+        }
+        state.used_bytes += entry->length;
+        MarkSlot(i, true);
+        owned.insert(std::upper_bound(owned.begin(), owned.end(), block), block);
+    }
+
+    // Blocs libres rechaînés, blocs occupés orphelins (Put interrompu) libérés
+    for (uint64_t off : blocks) {
+        CacheBlockHeader* block = BlockAt(off);
+        if (block->is_free) {
+            FreeListPush(off);
+        }
+    }
+    for (uint64_t off : blocks) {
+        if (!BlockAt(off)->is_free &&
+            !std::binary_search(owned.begin(), owned.end(), off)) {
+            FreeBlock(off);
+        }
+    }
+    if (!lock_.HasOtherProcesses()) {
+        ClearStalePins();
+    }
+
+    MarkDirty(mmap_base_, layout_.data_offset);
+    CommitDirty();
+}
+
+// pin_count est persistant : un processus mort avec des CacheHandle ouverts
+// laisse des entrées jamais évincées et des entrées retirées jamais libérées.
+// À n'appeler que sous verrou d'écriture, sans autre processus rattaché.
+void SharedCache::ClearStalePins() const {
+    CacheEntryHeader* entries = GetEntries();
+    uint32_t cleared = 0;
+    for (uint32_t i = 0; i < layout_.max_entries; ++i) {
+        CacheEntryHeader* entry = &entries[i];
+        if (!entry->is_used || (entry->pin_count == 0 && !entry->retired)) continue;
+        entry->pin_count = 0;
+        if (entry->retired) {
+            ReclaimEntry(i);
+        } else {
+            MarkDirty(entry, sizeof(CacheEntryHeader));
+        }
+        cleared++;
+    }
+    if (cleared != 0) {
+        fprintf(stderr, "Released %u entries pinned by dead processes\n", cleared);
+        MarkDirty(GetHeader(), sizeof(CacheHeader));
+    }
 }
 
 CacheHeader* SharedCache::GetHeader() const {
@@ -85,145 +505,788 @@ CacheHeader* SharedCache::GetHeader() const {
 
 CacheEntryHeader* SharedCache::GetEntries() const {
     return reinterpret_cast<CacheEntryHeader*>(
-        static_cast<uint8_t*>(mmap_base_) + sizeof(CacheHeader));
+        static_cast<uint8_t*>(mmap_base_) + layout_.entries_offset);
+}
+
+CacheIndexSlot* SharedCache::GetIndex(uint32_t ns) const {
+    return reinterpret_cast<CacheIndexSlot*>(
+        static_cast<uint8_t*>(mmap_base_) + layout_.index_offset) +
+        static_cast<size_t>(ns) * layout_.index_buckets;
+}
+
+uint64_t* SharedCache::GetFreeBitmap() const {
+    return reinterpret_cast<uint64_t*>(
+        static_cast<uint8_t*>(mmap_base_) + layout_.bitmap_offset);
+}
+
+uint8_t* SharedCache::GetSketch() const {
+    return static_cast<uint8_t*>(mmap_base_) + layout_.sketch_offset;
 }
 
 CacheEntryHeader* SharedCache::EntryAt(uint32_t index) const {
-    if (index >= CACHE_MAX_ENTRIES) return nullptr;
+    if (index >= layout_.max_entries) return nullptr;
     return &GetEntries()[index];
 }
 
 uint8_t* SharedCache::GetDataArea() const {
-    return static_cast<uint8_t*>(mmap_base_) + sizeof(CacheHeader) +
-           sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES;
+    return static_cast<uint8_t*>(mmap_base_) + layout_.data_offset;
 }
 
-int SharedCache::FindEntry(const std::string& key) const {
-    CacheEntryHeader* entries = GetEntries();
-    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
-        if (entries[i].is_used &&
-            strncmp(entries[i].key, key.c_str(), sizeof(entries[i].key) - 1) == 0) {
-            return i;
+// La clé est déjà un condensat : on mélange ses 8 premiers octets, au cas où
+// l'appelant fournirait des clés peu uniformes
+uint32_t SharedCache::HashKey(const CacheKey& key) {
+    uint64_t word;
+    memcpy(&word, key.bytes, sizeof(word));
+    word ^= word >> 33;
+    word *= 0xFF51AFD7ED558CCDULL;
+    word ^= word >> 33;
+    return static_cast<uint32_t>(word);
+}
+
+int SharedCache::FindEntry(uint32_t ns, const CacheKey& key, uint32_t hash,
+                           uint32_t* bucket) const {
+    CacheIndexSlot* index = GetIndex(ns);
+    const uint32_t mask = layout_.index_buckets - 1;
+    for (uint32_t b = hash & mask; index[b].entry_index != INDEX_EMPTY; b = (b + 1) & mask) {
+        if (index[b].key_hash != hash) continue;
+
+        CacheEntryHeader* entry = EntryAt(index[b].entry_index);
+        if (entry->key == key) {
+            if (bucket) *bucket = b;
+            return static_cast<int>(index[b].entry_index);
         }
     }
     return -1;
 }
 
 int SharedCache::FindFreeEntry() const {
-    CacheEntryHeader* entries = GetEntries();
-    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
-        if (!entries[i].is_used) {
-            return i;
+    uint64_t* bitmap = GetFreeBitmap();
+    for (uint32_t w = 0; w < layout_.bitmap_words; ++w) {
+        if (bitmap[w] != ~0ULL) {
+            uint32_t i = w * 64 + __builtin_ctzll(~bitmap[w]);
+            return i < layout_.max_entries ? static_cast<int>(i) : -1;
         }
     }
     return -1;
 }
 
-uint32_t SharedCache::CalculateChecksum(const uint8_t* data, uint32_t length) const {
-    uint32_t checksum = 0;
-    for (uint32_t i = 0; i < length; ++i) {
-        checksum = ((checksum << 5) + checksum) + data[i];
+void SharedCache::IndexInsert(uint32_t ns, uint32_t hash, uint32_t entry_index) const {
+    CacheIndexSlot* index = GetIndex(ns);
+    const uint32_t mask = layout_.index_buckets - 1;
+    uint32_t b = hash & mask;
+    while (index[b].entry_index != INDEX_EMPTY) {
+        b = (b + 1) & mask;
     }
-    return checksum;
+    index[b].key_hash = hash;
+    index[b].entry_index = entry_index;
+    MarkDirty(&index[b], sizeof(CacheIndexSlot));
 }
 
-bool SharedCache::Put(const std::string& key, const uint8_t* data, uint32_t length) {
-    EnsureInitialized();
-    if (!initialized_ || !data || length == 0) return false;
+// Suppression par décalage arrière : pas de pierres tombales à purger
+void SharedCache::IndexErase(uint32_t ns, uint32_t bucket) const {
+    CacheIndexSlot* index = GetIndex(ns);
+    const uint32_t mask = layout_.index_buckets - 1;
+    uint32_t hole = bucket;
+    uint32_t b = (bucket + 1) & mask;
+    while (index[b].entry_index != INDEX_EMPTY) {
+        uint32_t home = index[b].key_hash & mask;
+        // L'élément peut combler le trou si son bucket d'origine n'est pas dans ]hole, b]
+        if (((b - home) & mask) >= ((b - hole) & mask)) {
+            index[hole] = index[b];
+            MarkDirty(&index[hole], sizeof(CacheIndexSlot));
+            hole = b;
+        }
+        b = (b + 1) & mask;
+    }
+    index[hole].key_hash = 0;
+    index[hole].entry_index = INDEX_EMPTY;
+    MarkDirty(&index[hole], sizeof(CacheIndexSlot));
+}
 
-    std::lock_guard<std::mutex> lock(mutex_);
+void SharedCache::MarkSlot(uint32_t entry_index, bool used) const {
+    uint64_t bit = 1ULL << (entry_index % 64);
+    if (used) {
+        GetFreeBitmap()[entry_index / 64] |= bit;
+    } else {
+        GetFreeBitmap()[entry_index / 64] &= ~bit;
+    }
+    MarkDirty(&GetFreeBitmap()[entry_index / 64], sizeof(uint64_t));
+}
 
+CacheBlockHeader* SharedCache::BlockAt(uint64_t offset) const {
+    return reinterpret_cast<CacheBlockHeader*>(static_cast<uint8_t*>(mmap_base_) + offset);
+}
+
+void SharedCache::FreeListPush(uint64_t offset) const {
     CacheHeader* header = GetHeader();
+    CacheBlockHeader* block = BlockAt(offset);
+    uint64_t& head = header->free_lists[SizeClass(block->size)];
 
-    uint32_t available_space = CACHE_FILE_SIZE - header->next_offset;
-    if (length > available_space) {
-        if (!CompactCache()) {
-            fprintf(stderr, "Cache full, cannot add entry\n");
-            return false;
+    CacheFreeLink* link = reinterpret_cast<CacheFreeLink*>(block + 1);
+    link->next = head;
+    link->prev = 0;
+    if (head) {
+        reinterpret_cast<CacheFreeLink*>(BlockAt(head) + 1)->prev = offset;
+        MarkDirty(BlockAt(head), kBlockHeaderSize + sizeof(CacheFreeLink));
+    }
+    head = offset;
+
+    block->is_free = 1;
+    header->free_bytes += block->size;
+    MarkDirty(block, kBlockHeaderSize + sizeof(CacheFreeLink));
+}
+
+void SharedCache::FreeListRemove(uint64_t offset) const {
+    CacheHeader* header = GetHeader();
+    CacheBlockHeader* block = BlockAt(offset);
+    CacheFreeLink* link = reinterpret_cast<CacheFreeLink*>(block + 1);
+
+    if (link->prev) {
+        reinterpret_cast<CacheFreeLink*>(BlockAt(link->prev) + 1)->next = link->next;
+        MarkDirty(BlockAt(link->prev), kBlockHeaderSize + sizeof(CacheFreeLink));
+    } else {
+        header->free_lists[SizeClass(block->size)] = link->next;
+    }
+    if (link->next) {
+        reinterpret_cast<CacheFreeLink*>(BlockAt(link->next) + 1)->prev = link->prev;
+        MarkDirty(BlockAt(link->next), kBlockHeaderSize + sizeof(CacheFreeLink));
+    }
+
+    block->is_free = 0;
+    header->free_bytes -= block->size;
+    MarkDirty(block, kBlockHeaderSize);
+}
+
+// Ramène un bloc occupé à `size` octets et libère le reste s'il est exploitable
+void SharedCache::SplitBlock(uint64_t offset, uint64_t size) const {
+    CacheHeader* header = GetHeader();
+    CacheBlockHeader* block = BlockAt(offset);
+    if (block->size - size < kMinBlockSize) return;
+
+    uint64_t rest_offset = offset + size;
+    CacheBlockHeader* rest = BlockAt(rest_offset);
+    rest->size = block->size - size;
+    rest->prev_size = size;
+    rest->is_free = 0;
+    block->size = size;
+    MarkDirty(block, kBlockHeaderSize);
+    MarkDirty(rest, kBlockHeaderSize);
+
+    uint64_t after = rest_offset + rest->size;
+    if (after < header->next_offset) {
+        BlockAt(after)->prev_size = rest->size;
+        MarkDirty(BlockAt(after), kBlockHeaderSize);
+    } else {
+        header->last_block = rest_offset;
+    }
+    FreeBlock(rest_offset);
+}
+
+// Cherche d'abord dans la classe de la taille demandée (first fit), puis prend
+// la tête de la première classe supérieure non vide, et sinon découpe au sommet,
+// quitte à agrandir le fichier.
+uint64_t SharedCache::AllocateBlock(uint32_t length) const {
+    CacheHeader* header = GetHeader();
+    const uint64_t size = BlockSizeFor(length);
+
+    const uint32_t cls = SizeClass(size);
+    uint64_t found = 0;
+    for (uint64_t off = header->free_lists[cls]; off != 0;
+         off = reinterpret_cast<CacheFreeLink*>(BlockAt(off) + 1)->next) {
+        if (BlockAt(off)->size >= size) {
+            found = off;
+            break;
         }
-        available_space = CACHE_FILE_SIZE - header->next_offset;
-        if (length > available_space) {
-            fprintf(stderr, "Cache full after compaction\n");
-            return false;
+    }
+    for (uint32_t c = cls + 1; found == 0 && c < CACHE_SIZE_CLASSES; ++c) {
+        found = header->free_lists[c];
+    }
+
+    if (found != 0) {
+        FreeListRemove(found);
+        SplitBlock(found, size);
+        return found;
+    }
+
+    if (header->file_size - header->next_offset < size &&
+        !GrowFile(header->next_offset + size)) {
+        return 0;
+    }
+
+    uint64_t offset = header->next_offset;
+    CacheBlockHeader* block = BlockAt(offset);
+    block->size = size;
+    block->prev_size = header->last_block ? BlockAt(header->last_block)->size : 0;
+    block->is_free = 0;
+    MarkDirty(block, kBlockHeaderSize);
+    header->last_block = offset;
+    header->next_offset += size;
+    return offset;
+}
+
+// Fusionne avec les voisins libres ; un bloc qui touche le sommet y est rendu
+void SharedCache::FreeBlock(uint64_t offset) const {
+    CacheHeader* header = GetHeader();
+    CacheBlockHeader* block = BlockAt(offset);
+
+    uint64_t next = offset + block->size;
+    if (next < header->next_offset && BlockAt(next)->is_free) {
+        FreeListRemove(next);
+        block->size += BlockAt(next)->size;
+        Count(kMerges);
+    }
+
+    if (block->prev_size != 0) {
+        uint64_t prev = offset - block->prev_size;
+        if (BlockAt(prev)->is_free) {
+            FreeListRemove(prev);
+            Count(kMerges);
+            BlockAt(prev)->size += block->size;
+            offset = prev;
+            block = BlockAt(prev);
+        }
+    }
+
+    uint64_t end = offset + block->size;
+    if (end >= header->next_offset) {
+        header->next_offset = offset;
+        header->last_block = block->prev_size ? offset - block->prev_size : 0;
+        return;
+    }
+
+    BlockAt(end)->prev_size = block->size;
+    MarkDirty(BlockAt(end), kBlockHeaderSize);
+    FreeListPush(offset);
+}
+
+// Retire l'entrée de l'index ; si des handles la tiennent encore, le slot et
+// le bloc ne sont rendus qu'au dernier Unpin.
+void SharedCache::ReleaseEntry(uint32_t entry_index, uint32_t bucket) const {
+    CacheEntryHeader* entry = EntryAt(entry_index);
+    IndexErase(entry->ns, bucket);
+    GetHeader()->entry_count--;
+    GetHeader()->namespaces[entry->ns].entry_count--;
+
+    if (__atomic_load_n(&entry->pin_count, __ATOMIC_ACQUIRE) != 0) {
+        entry->retired = 1;
+        MarkDirty(entry, sizeof(CacheEntryHeader));
+        return;
+    }
+    ReclaimEntry(entry_index);
+}
+
+void SharedCache::ReclaimEntry(uint32_t entry_index) const {
+    CacheEntryHeader* entry = EntryAt(entry_index);
+    InvalidateEntry(entry);
+    if (entry->offset != 0) {
+        FreeBlock(entry->offset - kBlockHeaderSize);
+    }
+    MarkSlot(entry_index, false);
+    GetHeader()->namespaces[entry->ns].used_bytes -= entry->length;
+
+    entry->is_used = false;
+    entry->retired = 0;
+    entry->pin_count = 0;
+    entry->referenced = 0;
+    memset(&entry->key, 0, sizeof(entry->key));
+    entry->length = 0;
+    entry->offset = 0;
+    entry->checksum = 0;
+    entry->key_hash = 0;
+    entry->ns = 0;
+    MarkDirty(entry, sizeof(CacheEntryHeader));
+}
+
+// Les lecteurs sur place (CacheRef) relisent la génération après avoir lu les
+// données : elle doit changer avant que le bloc soit libéré ou réécrit.
+void SharedCache::InvalidateEntry(CacheEntryHeader* entry) const {
+    __atomic_store_n(&entry->generation, entry->generation + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// La décrémentation se fait sous verrou partagé : elle ne peut pas croiser un
+// écrivain en train de décider s'il retire l'entrée ou la libère.
+void SharedCache::Unpin(uint32_t entry_index) const {
+    bool reclaim = false;
+    {
+        ReadLock lock(this);
+        CacheEntryHeader* entry = EntryAt(entry_index);
+        reclaim = __atomic_sub_fetch(&entry->pin_count, 1, __ATOMIC_ACQ_REL) == 0 &&
+                  entry->retired;
+    }
+    if (!reclaim) return;
+
+    WriteLock lock(this);
+    CacheEntryHeader* entry = EntryAt(entry_index);
+    if (entry->retired && __atomic_load_n(&entry->pin_count, __ATOMIC_ACQUIRE) == 0) {
+        ReclaimEntry(entry_index);
+        MarkDirty(GetHeader(), sizeof(CacheHeader));
+        CommitDirty();
+    }
+}
+
+uint32_t SharedCache::BucketOf(uint32_t entry_index) const {
+    CacheIndexSlot* index = GetIndex(EntryAt(entry_index)->ns);
+    const uint32_t mask = layout_.index_buckets - 1;
+    uint32_t b = EntryAt(entry_index)->key_hash & mask;
+    while (index[b].entry_index != entry_index) {
+        b = (b + 1) & mask;
+    }
+    return b;
+}
+
+// Incrément conservateur : seuls les compteurs minimaux augmentent.
+// Appelé aussi sous verrou partagé, d'où les accès atomiques (comptage approximatif).
+void SharedCache::RecordAccess(uint32_t hash) const {
+    if (eviction_policy_ != EvictionPolicy::kTinyLfu) return;
+
+    uint8_t* sketch = GetSketch();
+    const uint32_t width = layout_.sketch_width;
+    uint8_t current = EstimateFrequency(hash);
+    if (current < kSketchMax) {
+        for (uint32_t row = 0; row < CACHE_SKETCH_ROWS; ++row) {
+            uint8_t* counter = &sketch[row * width + SketchColumn(hash, row, width)];
+            if (__atomic_load_n(counter, __ATOMIC_RELAXED) == current) {
+                __atomic_store_n(counter, current + 1, __ATOMIC_RELAXED);
+            }
         }
     }
 
-    int idx = FindEntry(key);
-    if (idx == -1) {
-        idx = FindFreeEntry();
+    CacheHeader* header = GetHeader();
+    const uint32_t reset_after = layout_.max_entries * kSketchResetFactor;
+    if (__atomic_add_fetch(&header->sketch_additions, 1, __ATOMIC_RELAXED) == reset_after) {
+        for (uint32_t i = 0; i < CACHE_SKETCH_ROWS * width; ++i) {
+            __atomic_store_n(&sketch[i], __atomic_load_n(&sketch[i], __ATOMIC_RELAXED) >> 1,
+                             __ATOMIC_RELAXED);
+        }
+        __atomic_sub_fetch(&header->sketch_additions, reset_after / 2, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t SharedCache::EstimateFrequency(uint32_t hash) const {
+    const uint8_t* sketch = GetSketch();
+    const uint32_t width = layout_.sketch_width;
+    uint8_t estimate = kSketchMax;
+    for (uint32_t row = 0; row < CACHE_SKETCH_ROWS; ++row) {
+        estimate = std::min(estimate, __atomic_load_n(
+            &sketch[row * width + SketchColumn(hash, row, width)], __ATOMIC_RELAXED));
+    }
+    return estimate;
+}
+
+// Seules les entrées de l'espace `ns` sont candidates, chacun a son aiguille
+int SharedCache::SelectVictim(uint32_t ns, int exclude) const {
+    CacheEntryHeader* entries = GetEntries();
+    uint32_t& hand = GetHeader()->namespaces[ns].clock_hand;
+
+    if (eviction_policy_ == EvictionPolicy::kClock) {
+        // Deux tours suffisent : le premier efface tous les bits de référence
+        for (uint32_t step = 0; step < 2 * layout_.max_entries; ++step) {
+            uint32_t i = hand;
+            hand = (i + 1) % layout_.max_entries;
+            if (!entries[i].is_used || entries[i].ns != ns || entries[i].retired ||
+                entries[i].pin_count != 0 || static_cast<int>(i) == exclude) continue;
+            if (entries[i].referenced) {
+                entries[i].referenced = 0;
+                continue;
+            }
+            return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // kTinyLfu : l'entrée la moins fréquente parmi un échantillon pris à l'aiguille
+    int victim = -1;
+    uint32_t victim_frequency = 0;
+    uint32_t sampled = 0;
+    for (uint32_t step = 0; step < layout_.max_entries && sampled < kLfuSampleSize; ++step) {
+        uint32_t i = hand;
+        hand = (i + 1) % layout_.max_entries;
+        if (!entries[i].is_used || entries[i].ns != ns || entries[i].retired ||
+            entries[i].pin_count != 0 || static_cast<int>(i) == exclude) continue;
+
+        uint32_t frequency = EstimateFrequency(entries[i].key_hash);
+        if (victim == -1 || frequency < victim_frequency) {
+            victim = static_cast<int>(i);
+            victim_frequency = frequency;
+        }
+        sampled++;
+    }
+    return victim;
+}
+
+bool SharedCache::EvictOne(uint32_t ns, uint32_t candidate_hash, int exclude) const {
+    if (eviction_policy_ == EvictionPolicy::kNone) return false;
+
+    int victim = SelectVictim(ns, exclude);
+    if (victim == -1) return false;
+
+    // Filtre d'admission : un nouveau venu ne chasse pas une entrée plus populaire
+    if (eviction_policy_ == EvictionPolicy::kTinyLfu &&
+        EstimateFrequency(candidate_hash) <= EstimateFrequency(EntryAt(victim)->key_hash)) {
+        return false;
+    }
+
+    ReleaseEntry(victim, BucketOf(victim));
+    Count(kEvictions);
+    return true;
+}
+
+// Place qu'un bloc de `size` octets trouverait au mieux : libre, au-delà du
+// sommet jusqu'à max_file_size, et blocs des entrées évinçables de l'espace.
+// Sinon, évincer viderait l'espace sans jamais suffire.
+bool SharedCache::CanReclaim(uint32_t ns, uint64_t size) const {
+    CacheHeader* header = GetHeader();
+    uint64_t available = header->free_bytes + (header->max_file_size - header->next_offset);
+    CacheEntryHeader* entries = GetEntries();
+    for (uint32_t i = 0; available < size && i < layout_.max_entries; ++i) {
+        if (!entries[i].is_used || entries[i].ns != ns || entries[i].retired ||
+            entries[i].pin_count != 0) continue;
+        available += BlockAt(entries[i].offset - kBlockHeaderSize)->size;
+    }
+    return available >= size;
+}
+
+// Un thread garde la même ligne : pas de rebond entre cœurs à chaque compteur
+void SharedCache::Count(Counter counter, uint64_t amount) const {
+    static std::atomic<uint32_t> next_shard{0};
+    static thread_local uint32_t shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % CACHE_COUNTER_SHARDS;
+    counters_[shard].values[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t SharedCache::TraceStart() const {
+    if (!trace_hook_.load(std::memory_order_relaxed)) return 0;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+void SharedCache::TraceEnd(const char* stage, uint64_t start_ns) const {
+    TraceHook hook = trace_hook_.load(std::memory_order_relaxed);
+    if (start_ns == 0 || !hook) return;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    hook(stage, start_ns, static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec);
+}
+
+uint32_t SharedCache::CalculateChecksum(const uint8_t* data, uint32_t length) const {
+    return Crc32c(data, length);
+}
+
+bool SharedCache::NeedsVerification(uint32_t entry_index, uint32_t generation) const {
+    switch (verify_policy_.load(std::memory_order_relaxed)) {
+    case VerifyPolicy::kAlways:
+        return true;
+    case VerifyPolicy::kFirstRead:
+        return verified_[entry_index].load(std::memory_order_relaxed) != generation + 1;
+    case VerifyPolicy::kBackground:
+        return false;
+    }
+    return true;
+}
+
+void SharedCache::MarkVerified(uint32_t entry_index, uint32_t generation) const {
+    verified_[entry_index].store(generation + 1, std::memory_order_relaxed);
+}
+
+bool SharedCache::Put(CacheNamespace ns, const CacheKey& key, const uint8_t* data, uint32_t length) {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || !data || length == 0 || n >= CACHE_NAMESPACES) return false;
+
+    WriteLock lock(this);
+    bool stored = PutLocked(n, key, data, length);
+    CommitDirty();
+    return stored;
+}
+
+size_t SharedCache::PutMany(CacheNamespace ns, const CacheWrite* writes, size_t count, bool* stored) {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) {
+        std::fill(stored, stored + count, false);
+        return 0;
+    }
+
+    // Un seul verrou et une seule synchronisation pour tout le lot
+    WriteLock lock(this);
+    size_t stored_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        stored[i] = writes[i].data && writes[i].length != 0 &&
+                    PutLocked(n, writes[i].key, writes[i].data, writes[i].length);
+        if (stored[i]) ++stored_count;
+    }
+    CommitDirty();
+    return stored_count;
+}
+
+// Sous verrou d'écriture ; les pages touchées restent à synchroniser par l'appelant
+bool SharedCache::PutLocked(uint32_t n, const CacheKey& key, const uint8_t* data, uint32_t length) {
+    CacheHeader* header = GetHeader();
+    CacheNamespaceState& state = header->namespaces[n];
+
+    // Plus grand que le budget entier : aucune éviction n'y suffirait, on
+    // refuse avant de vider l'espace pour rien
+    if (length > state.budget_bytes) {
+        fprintf(stderr, "Namespace %u budget too small for %u bytes\n", n, length);
+        Count(kRejectedWrites);
+        return false;
+    }
+
+    // Ni le budget ni la zone de données entière ne pourraient l'accueillir
+    const uint64_t size = BlockSizeFor(length);
+    if (size > header->max_file_size - layout_.data_offset) {
+        fprintf(stderr, "Entry of %u bytes larger than the cache\n", length);
+        Count(kRejectedWrites);
+        return false;
+    }
+
+    const uint32_t hash = HashKey(key);
+    RecordAccess(hash);
+
+    uint32_t bucket = 0;
+    int idx = FindEntry(n, key, hash, &bucket);
+    uint64_t block_offset = 0;
+
+    // Entrée tenue par des handles : l'ancienne version reste lisible, la
+    // nouvelle prend un autre slot
+    if (idx != -1 && __atomic_load_n(&GetEntries()[idx].pin_count, __ATOMIC_ACQUIRE) != 0) {
+        ReleaseEntry(idx, bucket);
+        idx = -1;
+    }
+
+    // Budget de l'espace : on ne fait de place qu'à ses propres dépens
+    const uint64_t replaced = idx != -1 ? EntryAt(idx)->length : 0;
+    while (state.used_bytes - replaced + length > state.budget_bytes && EvictOne(n, hash, idx)) {
+    }
+    if (state.used_bytes - replaced + length > state.budget_bytes) {
+        MarkDirty(header, sizeof(CacheHeader));
+        fprintf(stderr, "Namespace %u over budget, cannot add entry\n", n);
+        Count(kRejectedWrites);
+        return false;
+    }
+
+    if (idx != -1) {
+        // Réécriture : sur place si le bloc actuel suffit, sinon nouveau bloc
+        CacheEntryHeader* entry = EntryAt(idx);
+        InvalidateEntry(entry);
+        uint64_t old_block = entry->offset - kBlockHeaderSize;
+
+        if (BlockAt(old_block)->size >= size) {
+            SplitBlock(old_block, size);
+            block_offset = old_block;
+        } else {
+            block_offset = AllocateBlock(length);
+            // Le bloc actuel compte : il est libéré si l'allocation échoue
+            bool reclaim = block_offset == 0 && CanReclaim(n, size);
+            while (block_offset == 0 && reclaim && EvictOne(n, hash, idx)) {
+                block_offset = AllocateBlock(length);
+            }
+            if (block_offset == 0) {
+                // Le bloc libéré peut fusionner avec ses voisins et suffire
+                FreeBlock(old_block);
+                entry->offset = 0;
+                block_offset = AllocateBlock(length);
+                if (block_offset == 0) {
+                    ReleaseEntry(idx, BucketOf(idx));
+                    MarkDirty(header, sizeof(CacheHeader));
+                    fprintf(stderr, "Cache full, cannot add entry\n");
+                    Count(kRejectedWrites);
+                    return false;
+                }
+            } else {
+                FreeBlock(old_block);
+            }
+        }
+    } else {
+        // Quota d'entrées de l'espace, puis slot libre dans la table commune
+        if (state.entry_count < state.max_entries || EvictOne(n, hash, -1)) {
+            idx = FindFreeEntry();
+            if (idx == -1 && EvictOne(n, hash, -1)) {
+                idx = FindFreeEntry();
+            }
+        }
         if (idx == -1) {
+            MarkDirty(header, sizeof(CacheHeader));
             fprintf(stderr, "No free entries available\n");
+            Count(kRejectedWrites);
             return false;
         }
+        block_offset = AllocateBlock(length);
+        bool reclaim = block_offset == 0 && CanReclaim(n, size);
+        while (block_offset == 0 && reclaim && EvictOne(n, hash, -1)) {
+            block_offset = AllocateBlock(length);
+        }
+        if (block_offset == 0) {
+            // Des évictions ont pu avoir lieu avant l'échec
+            MarkDirty(header, sizeof(CacheHeader));
+            fprintf(stderr, "Cache full, cannot add entry\n");
+            Count(kRejectedWrites);
+            return false;
+        }
+        IndexInsert(n, hash, idx);
+        MarkSlot(idx, true);
         header->entry_count++;
+        state.entry_count++;
     }
 
     CacheEntryHeader* entry = EntryAt(idx);
 
-    strncpy(entry->key, key.c_str(), sizeof(entry->key) - 1);
-    entry->key[sizeof(entry->key) - 1] = '\0';
+    // Slot neuf : length vaut 0 ; réécriture : on remplace l'ancienne taille
+    state.used_bytes = state.used_bytes - entry->length + length;
+
+    entry->key = key;
     entry->length = length;
-    entry->offset = header->next_offset;
+    entry->offset = block_offset + kBlockHeaderSize;
     entry->is_used = true;
+    entry->referenced = 0;
+    entry->retired = 0;
+    entry->ns = static_cast<uint8_t>(n);
+    __atomic_store_n(&entry->generation, entry->generation + 1, __ATOMIC_RELAXED);
     entry->checksum = CalculateChecksum(data, length);
+    entry->key_hash = hash;
 
-    uint8_t* dest = GetDataArea() + (entry->offset - (sizeof(CacheHeader) +
-                    sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES));
+    uint8_t* dest = GetDataArea() + (entry->offset - layout_.data_offset);
     memcpy(dest, data, length);
 
-    header->next_offset += length;
-
-    msync(mmap_base_, mmap_size_, MS_SYNC);
+    MarkDirty(entry, sizeof(CacheEntryHeader));
+    MarkDirty(dest, length);
+    MarkDirty(header, sizeof(CacheHeader));
 
+    Count(kWrites);
+    Count(kBytesWritten, length);
     return true;
 }
 
-bool SharedCache::Get(const std::string& key, const uint8_t** data, uint32_t& length) const {
+// Sous verrou partagé : indice de l'entrée vérifiée, marquée comme lue, ou -1
+int SharedCache::LookupLocked(uint32_t n, const CacheKey& key) const {
+    int idx = FindEntry(n, key, HashKey(key));
+    CacheEntryHeader* entry = idx != -1 ? &GetEntries()[idx] : nullptr;
+    if (!entry || !entry->is_used) {
+        Count(kMisses);
+        return -1;
+    }
+
+    if (NeedsVerification(idx, entry->generation)) {
+        const uint8_t* data_ptr = GetDataArea() + (entry->offset - layout_.data_offset);
+        uint64_t start = TraceStart();
+        bool intact = CalculateChecksum(data_ptr, entry->length) == entry->checksum;
+        TraceEnd("cache.verify", start);
+        if (!intact) {
+            fprintf(stderr, "Data corruption detected for key: %s\n", key.ToHex().c_str());
+            Count(kCorruptions);
+            Count(kMisses);
+            return -1;
+        }
+        MarkVerified(idx, entry->generation);
+    }
+
+    // Métadonnées d'accès : écrites sous verrou partagé, jamais synchronisées
+    __atomic_store_n(&entry->referenced, 1, __ATOMIC_RELAXED);
+    RecordAccess(entry->key_hash);
+    Count(kHits);
+    Count(kBytesRead, entry->length);
+    return idx;
+}
+
+CacheHandle SharedCache::Acquire(CacheNamespace ns, const CacheKey& key) const {
     EnsureInitialized();
-    if (!initialized_) return false;
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return CacheHandle();
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReadLock lock(this);
 
-    int idx = FindEntry(key);
-    if (idx == -1) return false;
+    int idx = LookupLocked(n, key);
+    if (idx == -1) return CacheHandle();
 
-    CacheEntryHeader* entry = EntryAt(idx);
-    if (!entry || !entry->is_used) return false;
+    CacheEntryHeader* entry = &GetEntries()[idx];
+    __atomic_add_fetch(&entry->pin_count, 1, __ATOMIC_ACQ_REL);
+    return CacheHandle(this, idx, GetDataArea() + (entry->offset - layout_.data_offset), entry->length);
+}
 
-    uint8_t* data_ptr = GetDataArea() + (entry->offset - (sizeof(CacheHeader) +
-                       sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES));
+size_t SharedCache::ReadMany(CacheNamespace ns, const CacheKey* keys, size_t count,
+                             const std::function<void(size_t, const uint8_t*, uint32_t)>& visitor) const {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return 0;
 
-    uint32_t calculated_checksum = CalculateChecksum(data_ptr, entry->length);
-    if (calculated_checksum != entry->checksum) {
-        fprintf(stderr, "Data corruption detected for key: %s\n", key.c_str());
-        return false;
+    // Rien n'est épinglé : les octets ne sont lus que sous le verrou
+    ReadLock lock(this);
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int idx = LookupLocked(n, keys[i]);
+        if (idx == -1) continue;
+        const CacheEntryHeader* entry = &GetEntries()[idx];
+        visitor(i, GetDataArea() + (entry->offset - layout_.data_offset), entry->length);
+        ++found;
     }
+    return found;
+}
 
-    *data = data_ptr;
-    length = entry->length;
-    return true;
+size_t SharedCache::ReadMany(CacheNamespace ns, const CacheKey* keys, size_t count,
+                             const std::function<bool(uint64_t)>& prepare,
+                             const std::function<void(size_t, const uint8_t*, uint32_t)>& visitor) const {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return 0;
+
+    // Indices alloués hors du verrou ; compteurs, sketch et vérification
+    // une seule fois par clé
+    std::vector<int> indices(count);
+    ReadLock lock(this);
+    size_t found = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        indices[i] = LookupLocked(n, keys[i]);
+        if (indices[i] == -1) continue;
+        total += GetEntries()[indices[i]].length;
+        ++found;
+    }
+    if (!prepare(total)) return found;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (indices[i] == -1) continue;
+        const CacheEntryHeader* entry = &GetEntries()[indices[i]];
+        visitor(i, GetDataArea() + (entry->offset - layout_.data_offset), entry->length);
+    }
+    return found;
 }
 
-bool SharedCache::Remove(const std::string& key) {
+bool SharedCache::Locate(CacheNamespace ns, const CacheKey& key, CacheRef* ref) const {
     EnsureInitialized();
-    if (!initialized_) return false;
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return false;
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReadLock lock(this);
 
-    int idx = FindEntry(key);
+    int idx = LookupLocked(n, key);
     if (idx == -1) return false;
 
-    CacheEntryHeader* entry = EntryAt(idx);
-    entry->is_used = false;
-    memset(entry->key, 0, sizeof(entry->key));
-    entry->length = 0;
-    entry->offset = 0;
-    entry->checksum = 0;
+    const CacheEntryHeader* entry = &GetEntries()[idx];
+    ref->offset = entry->offset;
+    ref->length = entry->length;
+    ref->entry_index = static_cast<uint32_t>(idx);
+    ref->generation = entry->generation;
+    ref->checksum = entry->checksum;
+    return true;
+}
 
-    CacheHeader* header = GetHeader();
-    header->entry_count--;
+bool SharedCache::Remove(CacheNamespace ns, const CacheKey& key) {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return false;
 
-    msync(mmap_base_, mmap_size_, MS_SYNC);
+    WriteLock lock(this);
+
+    uint32_t bucket = 0;
+    int idx = FindEntry(n, key, HashKey(key), &bucket);
+    if (idx == -1) return false;
+
+    ReleaseEntry(idx, bucket);
+
+    MarkDirty(GetHeader(), sizeof(CacheHeader));
+    CommitDirty();
 
     return true;
 }
@@ -232,69 +1295,313 @@ void SharedCache::Clear() {
     EnsureInitialized();
     if (!initialized_) return;
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    WriteLock lock(this);
     InitializeCache();
 }
 
-// CHANGEMENT : Ajouter const à la signature
-bool SharedCache::CompactCache() const {
-    CacheHeader* header = GetHeader();
-    CacheEntryHeader* entries = GetEntries();
+void SharedCache::SetEvictionPolicy(EvictionPolicy policy) {
+    eviction_policy_ = policy;
+}
+
+EvictionPolicy SharedCache::GetEvictionPolicy() const {
+    return eviction_policy_;
+}
+
+void SharedCache::SetDurabilityMode(DurabilityMode mode, std::chrono::milliseconds flush_interval) {
+    StopFlusher();
+    durability_mode_ = mode;
+    if (mode == DurabilityMode::kGroupCommit) {
+        std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+        flush_interval_ = flush_interval;
+        flusher_stop_ = false;
+        flusher_ = std::thread(&SharedCache::FlusherLoop, this);
+    }
+}
 
-    uint32_t write_offset = sizeof(CacheHeader) + sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES;
-    uint8_t* data_area = GetDataArea();
+DurabilityMode SharedCache::GetDurabilityMode() const {
+    return durability_mode_;
+}
+
+// Force la synchronisation des écritures en attente du flusher
+void SharedCache::Flush() {
+    EnsureInitialized();
+    if (!initialized_) return;
+
+    PageSet pages;
+    pages.Reset(pending_pages_.words.size() * 64);
+    {
+        std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+        pages.Merge(pending_pages_);
+        pending_pages_.Clear();
+    }
+    SyncPages(pages);
+}
 
-    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
-        if (entries[i].is_used && entries[i].length > 0) {
-            uint32_t old_offset = entries[i].offset;
-            uint32_t data_offset = old_offset - (sizeof(CacheHeader) +
-                                  sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES);
+void SharedCache::MarkDirty(const void* address, size_t length) const {
+    if (durability_mode_ == DurabilityMode::kNone || length == 0) return;
 
-            if (write_offset != old_offset) {
-                memmove(data_area + (write_offset - (sizeof(CacheHeader) +
-                       sizeof(CacheEntryHeader) * CACHE_MAX_ENTRIES)),
-                       data_area + data_offset, entries[i].length);
-                entries[i].offset = write_offset;
+    size_t offset = static_cast<const uint8_t*>(address) - static_cast<uint8_t*>(mmap_base_);
+    dirty_pages_.Add(offset / kPageSize, (offset + length - 1) / kPageSize);
+}
+
+// Appelé en fin d'écriture, sous le verrou d'écriture
+void SharedCache::CommitDirty() const {
+    if (durability_mode_ == DurabilityMode::kRange) {
+        uint64_t start = TraceStart();
+        SyncPages(dirty_pages_);
+        TraceEnd("cache.sync", start);
+    } else if (durability_mode_ == DurabilityMode::kGroupCommit) {
+        std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+        pending_pages_.Merge(dirty_pages_);
+    }
+    dirty_pages_.Clear();
+}
+
+// Un msync par suite contiguë de pages marquées
+void SharedCache::SyncPages(const PageSet& pages) const {
+    uint8_t* base = static_cast<uint8_t*>(mmap_base_);
+    const size_t mapped = mapped_size_.load(std::memory_order_acquire);
+    size_t run_start = 0;
+    size_t run_length = 0;
+
+    for (size_t w = pages.lo; w < pages.hi; ++w) {
+        if (pages.words[w] == 0 && run_length == 0) continue;
+        for (size_t bit = 0; bit < 64; ++bit) {
+            size_t page = w * 64 + bit;
+            if (pages.words[w] & (1ULL << bit)) {
+                if (run_length == 0) run_start = page;
+                run_length++;
+            } else if (run_length != 0) {
+                msync(base + run_start * kPageSize, run_length * kPageSize, MS_SYNC);
+                run_length = 0;
             }
+        }
+    }
+    if (run_length != 0) {
+        size_t length = std::min(run_length * kPageSize, mapped - run_start * kPageSize);
+        msync(base + run_start * kPageSize, length, MS_SYNC);
+    }
+}
+
+void SharedCache::PageSet::Reset(size_t page_count) {
+    words.assign((page_count + 63) / 64, 0);
+    lo = 0;
+    hi = 0;
+}
+
+void SharedCache::PageSet::Add(size_t first, size_t last) {
+    if (lo == hi) {
+        lo = first / 64;
+        hi = lo;
+    }
+    lo = std::min(lo, first / 64);
+    hi = std::max(hi, last / 64 + 1);
+    for (size_t page = first; page <= last; ++page) {
+        words[page / 64] |= 1ULL << (page % 64);
+    }
+}
+
+void SharedCache::PageSet::Merge(const PageSet& other) {
+    if (other.lo == other.hi) return;
+    if (lo == hi) {
+        lo = other.lo;
+        hi = other.lo;
+    }
+    lo = std::min(lo, other.lo);
+    hi = std::max(hi, other.hi);
+    for (size_t w = other.lo; w < other.hi; ++w) {
+        words[w] |= other.words[w];
+    }
+}
 
-            write_offset += entries[i].length;
+void SharedCache::PageSet::Clear() {
+    std::fill(words.begin() + lo, words.begin() + hi, 0);
+    lo = 0;
+    hi = 0;
+}
+
+void SharedCache::FlusherLoop() {
+    PageSet pages;
+    std::unique_lock<std::mutex> flush_lock(flush_mutex_);
+    pages.Reset(pending_pages_.words.size() * 64);
+    while (!flusher_stop_) {
+        flush_cv_.wait_for(flush_lock, flush_interval_);
+
+        pages.Merge(pending_pages_);
+        pending_pages_.Clear();
+        flush_lock.unlock();
+        SyncPages(pages);
+        pages.Clear();
+        flush_lock.lock();
+    }
+}
+
+void SharedCache::StopFlusher() {
+    {
+        std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+        flusher_stop_ = true;
+    }
+    flush_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
+
+void SharedCache::SetVerifyPolicy(VerifyPolicy policy, std::chrono::milliseconds scrub_interval) {
+    StopScrubber();
+    verify_policy_ = policy;
+    if (policy == VerifyPolicy::kBackground) {
+        std::lock_guard<std::mutex> scrub_lock(scrub_mutex_);
+        scrub_interval_ = scrub_interval;
+        scrubber_stop_ = false;
+        scrubber_ = std::thread(&SharedCache::ScrubberLoop, this);
+    }
+}
+
+VerifyPolicy SharedCache::GetVerifyPolicy() const {
+    return verify_policy_;
+}
+
+// Vérifie une entrée hors verrou, épinglée ; une entrée corrompue est retirée
+void SharedCache::ScrubEntry(uint32_t entry_index) const {
+    const uint8_t* data = nullptr;
+    uint32_t length = 0;
+    uint32_t checksum = 0;
+    uint32_t generation = 0;
+    {
+        ReadLock lock(this);
+        CacheEntryHeader* entry = EntryAt(entry_index);
+        if (!entry->is_used || entry->retired) return;
+        generation = entry->generation;
+        if (verified_[entry_index].load(std::memory_order_relaxed) == generation + 1) return;
+
+        data = GetDataArea() + (entry->offset - layout_.data_offset);
+        length = entry->length;
+        checksum = entry->checksum;
+        __atomic_add_fetch(&entry->pin_count, 1, __ATOMIC_ACQ_REL);
+    }
+
+    bool intact = CalculateChecksum(data, length) == checksum;
+    if (intact) {
+        MarkVerified(entry_index, generation);
+    } else {
+        WriteLock lock(this);
+        CacheEntryHeader* entry = EntryAt(entry_index);
+        if (entry->is_used && !entry->retired && entry->generation == generation) {
+            fprintf(stderr, "Data corruption detected for key: %s\n", entry->key.ToHex().c_str());
+            ReleaseEntry(entry_index, BucketOf(entry_index));
+            MarkDirty(GetHeader(), sizeof(CacheHeader));
+            CommitDirty();
         }
     }
+    Unpin(entry_index);
+}
 
-    header->next_offset = write_offset;
-    return true;
+void SharedCache::ScrubberLoop() {
+    EnsureInitialized();
+    if (!initialized_) return;
+
+    std::unique_lock<std::mutex> scrub_lock(scrub_mutex_);
+    while (!scrubber_stop_) {
+        scrub_lock.unlock();
+        for (uint32_t i = 0; i < layout_.max_entries; ++i) {
+            ScrubEntry(i);
+        }
+        scrub_lock.lock();
+        scrub_cv_.wait_for(scrub_lock, scrub_interval_, [this] { return scrubber_stop_; });
+    }
+}
+
+void SharedCache::StopScrubber() {
+    {
+        std::lock_guard<std::mutex> scrub_lock(scrub_mutex_);
+        scrubber_stop_ = true;
+    }
+    scrub_cv_.notify_all();
+    if (scrubber_.joinable()) {
+        scrubber_.join();
+    }
 }
 
 uint32_t SharedCache::GetEntryCount() const {
     EnsureInitialized();
     if (!initialized_) return 0;
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReadLock lock(this);
     return GetHeader()->entry_count;
 }
 
-uint32_t SharedCache::GetUsedSpace() const {
+uint32_t SharedCache::GetEntryCount(CacheNamespace ns) const {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return 0;
+
+    ReadLock lock(this);
+    return GetHeader()->namespaces[n].entry_count;
+}
+
+uint64_t SharedCache::GetNamespaceBytes(CacheNamespace ns) const {
+    EnsureInitialized();
+    const uint32_t n = static_cast<uint32_t>(ns);
+    if (!initialized_ || n >= CACHE_NAMESPACES) return 0;
+
+    ReadLock lock(this);
+    return GetHeader()->namespaces[n].used_bytes;
+}
+
+uint64_t SharedCache::GetUsedSpace() const {
     EnsureInitialized();
     if (!initialized_) return 0;
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReadLock lock(this);
     CacheHeader* header = GetHeader();
-    return header->next_offset;
+    return header->next_offset - header->free_bytes;
 }
 
-uint32_t SharedCache::GetFreeSpace() const {
+uint64_t SharedCache::GetFreeSpace() const {
     EnsureInitialized();
     if (!initialized_) return 0;
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    return CACHE_FILE_SIZE - GetUsedSpace();
+    ReadLock lock(this);
+    CacheHeader* header = GetHeader();
+    return header->max_file_size - (header->next_offset - header->free_bytes);
+}
+
+uint64_t SharedCache::GetFileSize() const {
+    EnsureInitialized();
+    if (!initialized_) return 0;
+
+    ReadLock lock(this);
+    return GetHeader()->file_size;
+}
+
+CacheStats SharedCache::GetStats() const {
+    uint64_t totals[kCounterCount] = {};
+    for (const CounterShard& shard : counters_) {
+        for (uint32_t c = 0; c < kCounterCount; ++c) {
+            totals[c] += shard.values[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    CacheStats stats;
+    stats.hits = totals[kHits];
+    stats.misses = totals[kMisses];
+    stats.corruptions = totals[kCorruptions];
+    stats.writes = totals[kWrites];
+    stats.rejected_writes = totals[kRejectedWrites];
+    stats.evictions = totals[kEvictions];
+    stats.merges = totals[kMerges];
+    stats.file_grows = totals[kFileGrows];
+    stats.bytes_read = totals[kBytesRead];
+    stats.bytes_written = totals[kBytesWritten];
+    return stats;
 }
 
 bool SharedCache::IsValid() const {
     EnsureInitialized();
     if (!initialized_) return false;
 
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReadLock lock(this);
     CacheHeader* header = GetHeader();
     return header->magic_number == CACHE_MAGIC && header->version == CACHE_VERSION;
 }
@@ -3,42 +3,241 @@
 
 #include <string>
 #include <mutex>
+#include <vector>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 #include <cstdint>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <memory>
+#include <functional>
+#include "m_shared_lock.h"
+#include "m_cache_key.h"
 
+// Valeurs par défaut de CacheConfig
 #define CACHE_FILE_PATH "/tmp/v8_code_cache"
-#define CACHE_FILE_SIZE (1024 * 1024 * 100) // 100 Mo
+#define CACHE_FILE_SIZE (1024 * 1024 * 100) // 100 Mo à la création
+#define CACHE_MAX_FILE_SIZE (1024ULL * 1024 * 1024 * 4) // 4 Go au plus, par croissance
 #define CACHE_MAX_ENTRIES 1024
 
+#define CACHE_SIZE_CLASSES 64      // Une liste libre par puissance de 2
+#define CACHE_SKETCH_ROWS 4
+#define CACHE_NAMESPACES 2         // Nombre de valeurs de CacheNamespace
+#define CACHE_COUNTER_SHARDS 16    // Compteurs d'activité répartis entre threads
+
 namespace m_cache {
 
-    struct CacheEntryHeader
+    // Type d'artefact : chaque espace a son index, son budget et sa propre
+    // éviction, un afflux de l'un ne chasse jamais les entrées de l'autre
+    enum class CacheNamespace : uint8_t
+    {
+        kIRGraph = 0,
+        kBytecode = 1,
+    };
+
+    // Une ligne de cache par entrée : la table reste compacte et une
+    // recherche ne touche qu'une ligne
+    struct alignas(64) CacheEntryHeader
     {
-        char function_name[256];    // Hash of the function name
-        char key[256];             // Hash of the section source code
+        CacheKey key;              // Condensat binaire de la section de code
+        uint64_t offset;           // Offset dans le fichier mmap
         uint32_t length;           // Taille des données
-        uint32_t offset;           // Offset dans le fichier mmap
-        bool is_used;              // Indique si l'entrée est utilisée
         uint32_t checksum;         // Checksum pour vérifier l'intégrité
+        uint32_t key_hash;         // Hash de la clé (copie de celui de l'index)
+        uint32_t pin_count;        // CacheHandle vivants, tous processus confondus
+        uint32_t generation;       // Incrémentée à chaque écriture ou libération du slot
+        uint8_t is_used;           // Indique si l'entrée est utilisée
+        uint8_t referenced;        // Bit de référence CLOCK, posé à chaque lecture
+        uint8_t retired;           // Retirée de l'index, libérée au dernier Unpin
+        uint8_t ns;                // CacheNamespace de l'entrée
+    };
+
+    static_assert(sizeof(CacheEntryHeader) == 64, "CacheEntryHeader doit tenir sur une ligne de cache");
+
+    // Case de l'index à adressage ouvert (sondage linéaire)
+    struct CacheIndexSlot
+    {
+        uint32_t key_hash;         // Hash de la clé, comparé avant la clé complète
+        uint32_t entry_index;      // Indice de l'entrée, ou INDEX_EMPTY
+    };
+
+    // En-tête de chaque bloc de la zone de données
+    struct CacheBlockHeader
+    {
+        uint64_t size;             // Taille totale du bloc, en-tête compris
+        uint64_t prev_size;        // Taille du bloc précédent (0 pour le premier)
+        uint32_t is_free;          // Bloc chaîné dans une liste libre
+        uint32_t reserved[3];
+    };
+
+    // Chaînage d'un bloc libre, stocké dans sa charge utile
+    struct CacheFreeLink
+    {
+        uint64_t next;             // Offset du bloc libre suivant (0 = fin)
+        uint64_t prev;             // Offset du bloc libre précédent (0 = tête)
+    };
+
+    // Quotas et compteurs d'un espace de noms
+    struct CacheNamespaceState
+    {
+        uint64_t budget_bytes;     // Octets de données autorisés (0 : toute écriture refusée)
+        uint64_t used_bytes;       // Octets de données des entrées (retirées comprises)
+        uint32_t max_entries;      // Entrées indexées autorisées
+        uint32_t entry_count;      // Entrées indexées
+        uint32_t clock_hand;       // Prochaine entrée examinée par l'éviction
+        uint32_t reserved;
     };
 
     struct CacheHeader
     {
+        SharedRwLockState lock;    // Verrou commun à tous les processus qui mappent le fichier
         uint32_t magic_number;     // Pour vérifier la validité du cache
         uint32_t version;          // Version du format de cache
+        uint32_t max_entries;      // Capacité de la table d'entrées, fixée à la création
         uint32_t entry_count;      // Nombre d'entrées utilisées
-        uint32_t next_offset;      // Prochain offset libre
-        uint8_t padding[16];       // Padding pour alignement
+        uint64_t data_offset;      // Début de la zone de données (dépend de max_entries)
+        uint64_t file_size;        // Taille actuelle du fichier, ne fait que croître
+        uint64_t max_file_size;    // Plafond de croissance, fixé à la création
+        uint64_t next_offset;      // Sommet de la zone allouée (au-delà : jamais découpé)
+        uint64_t last_block;       // Offset du dernier bloc sous le sommet (0 = aucun)
+        uint64_t free_bytes;       // Octets dans les listes libres
+        uint64_t free_lists[CACHE_SIZE_CLASSES]; // Têtes des listes libres par classe
+        CacheNamespaceState namespaces[CACHE_NAMESPACES];
+        uint32_t sketch_additions; // Incréments du sketch depuis le dernier vieillissement
+    };
+
+    // Dimensions choisies au démarrage. Elles ne s'appliquent qu'à la création
+    // du fichier : un fichier valide existant garde les siennes.
+    struct CacheConfig
+    {
+        std::string path = CACHE_FILE_PATH;
+        uint64_t initial_size = CACHE_FILE_SIZE;  // Taille du fichier à la création
+        uint64_t max_size = CACHE_MAX_FILE_SIZE;  // Le fichier grandit jusqu'ici avant d'évincer
+        uint32_t max_entries = CACHE_MAX_ENTRIES;
+        // Part de max_size et de max_entries réservée à chaque CacheNamespace, en %
+        uint32_t namespace_share[CACHE_NAMESPACES] = {50, 50};
+    };
+
+    // Disposition du fichier, déduite de max_entries :
+    // CacheHeader | index par espace de noms | bitmap des entrées | sketch de fréquences | entrées | données
+    struct CacheLayout
+    {
+        uint32_t max_entries = 0;
+        uint32_t index_buckets = 0;    // Par espace de noms ; puissance de 2, facteur de charge <= 0.5
+        uint32_t sketch_width = 0;     // Puissance de 2
+        uint32_t bitmap_words = 0;
+        uint64_t index_offset = 0;
+        uint64_t bitmap_offset = 0;
+        uint64_t sketch_offset = 0;
+        uint64_t entries_offset = 0;
+        uint64_t data_offset = 0;
+
+        static CacheLayout For(uint32_t max_entries);
+    };
+
+    // Politique appliquée quand la zone de données ou la table d'entrées est pleine
+    enum class EvictionPolicy : uint32_t
+    {
+        kNone,      // Put échoue, comme avant
+        kClock,     // Seconde chance sur le bit de référence
+        kTinyLfu,   // LFU échantillonné, admission filtrée par un count-min sketch
+    };
+
+    // Garantie de persistance des écritures (Put, Remove)
+    enum class DurabilityMode : uint32_t
+    {
+        kNone,         // Cache de pages uniquement, le noyau écrit quand il veut
+        kRange,        // msync synchrone des seules pages modifiées, à chaque écriture
+        kGroupCommit,  // Pages modifiées accumulées et synchronisées par un thread de fond
+    };
+
+    // Quand vérifier le checksum CRC32C d'une entrée en lecture
+    enum class VerifyPolicy : uint32_t
+    {
+        kAlways,       // À chaque Acquire
+        kFirstRead,    // Au premier Acquire de chaque version de l'entrée par ce processus
+        kBackground,   // Jamais en lecture ; un thread de fond parcourt et purge le cache
+    };
+
+    class SharedCache;
+
+    // Emplacement d'une entrée dans le fichier, pour une lecture sur place par
+    // un autre processus (SharedCacheReader). Valable tant que la génération
+    // de l'entrée n'a pas changé.
+    struct CacheRef
+    {
+        uint64_t offset;           // Offset des données dans le fichier
+        uint32_t length;
+        uint32_t entry_index;
+        uint32_t generation;
+        uint32_t checksum;         // CRC32C des données, si le lecteur veut vérifier
+    };
+
+    // Écriture d'un lot (SharedCache::PutMany)
+    struct CacheWrite
+    {
+        CacheKey key;
+        const uint8_t* data;
+        uint32_t length;
+    };
+
+    // Activité de ce processus depuis son ouverture du cache (GetStats). Il
+    // n'y a pas de compactage séparé : la défragmentation se fait par fusion
+    // des blocs libres voisins, comptée dans merges.
+    struct CacheStats
+    {
+        uint64_t hits;             // Lectures trouvées (Acquire, Locate, ReadMany)
+        uint64_t misses;           // Clés absentes ou corrompues
+        uint64_t corruptions;      // Checksums invalides détectés en lecture
+        uint64_t writes;           // Écritures réussies
+        uint64_t rejected_writes;  // Écritures refusées (budget, cache plein)
+        uint64_t evictions;        // Entrées chassées pour faire de la place
+        uint64_t merges;           // Fusions de blocs libres
+        uint64_t file_grows;       // Agrandissements du fichier
+        uint64_t bytes_read;       // Octets des entrées trouvées
+        uint64_t bytes_written;    // Octets des écritures réussies
+    };
+
+    // Accès en lecture sans copie : tant que le handle vit, les octets de
+    // l'entrée restent en place (ni éviction, ni réécriture, ni libération).
+    class CacheHandle
+    {
+    public:
+        CacheHandle() = default;
+        ~CacheHandle();
+        CacheHandle(CacheHandle&& other) noexcept;
+        CacheHandle& operator=(CacheHandle&& other) noexcept;
+        CacheHandle(const CacheHandle&) = delete;
+        CacheHandle& operator=(const CacheHandle&) = delete;
+
+        explicit operator bool() const { return cache_ != nullptr; }
+        const uint8_t* data() const { return data_; }
+        uint32_t size() const { return length_; }
+
+        void Release();
+
+    private:
+        friend class SharedCache;
+        CacheHandle(const SharedCache* cache, uint32_t entry_index,
+                    const uint8_t* data, uint32_t length)
+            : cache_(cache), entry_index_(entry_index), data_(data), length_(length) {}
+
+        const SharedCache* cache_ = nullptr;
+        uint32_t entry_index_ = 0;
+        const uint8_t* data_ = nullptr;
+        uint32_t length_ = 0;
     };
 
     class SharedCache
     {
     public:
         static const uint32_t CACHE_MAGIC = 0xC4C4E001;
-        static const uint32_t CACHE_VERSION = 1;
+        static const uint32_t CACHE_VERSION = 10;
+        static const uint32_t INDEX_EMPTY = 0xFFFFFFFF;
 
         static SharedCache& Instance()
         {
@@ -46,41 +245,231 @@ namespace m_cache {
             return instance;
         }
 
-        bool Put(const std::string& key, const uint8_t* data, uint32_t length);
-        bool Get(const std::string& key, const uint8_t** data, uint32_t& length) const;
-        bool Remove(const std::string& key);
+        // À appeler avant toute autre méthode ; false si le cache est déjà ouvert
+        bool Configure(const CacheConfig& config);
+
+        bool Put(CacheNamespace ns, const CacheKey& key, const uint8_t* data, uint32_t length);
+        // Handle vide si la clé est absente ou corrompue
+        CacheHandle Acquire(CacheNamespace ns, const CacheKey& key) const;
+        // Sans épinglage : false si la clé est absente ou corrompue
+        bool Locate(CacheNamespace ns, const CacheKey& key, CacheRef* ref) const;
+        bool Remove(CacheNamespace ns, const CacheKey& key);
+
+        // Lots : un seul passage par le verrou pour toutes les clés.
+        // visitor(i, data, length) est appelé pour chaque clé i trouvée, sous
+        // verrou partagé : data n'est valable que pendant l'appel, qui ne
+        // doit pas rappeler le cache. Retourne le nombre de clés trouvées.
+        size_t ReadMany(CacheNamespace ns, const CacheKey* keys, size_t count,
+                        const std::function<void(size_t, const uint8_t*, uint32_t)>& visitor) const;
+        // Variante pour une sortie dimensionnée d'avance : chaque clé n'est
+        // cherchée qu'une fois, puis prepare(total) reçoit, sous le même
+        // verrou, la taille cumulée des clés trouvées avant le premier
+        // visitor. Si prepare retourne false, aucun visitor n'est appelé.
+        size_t ReadMany(CacheNamespace ns, const CacheKey* keys, size_t count,
+                        const std::function<bool(uint64_t)>& prepare,
+                        const std::function<void(size_t, const uint8_t*, uint32_t)>& visitor) const;
+        // stored[i] : résultat de writes[i]. Retourne le nombre d'entrées écrites.
+        size_t PutMany(CacheNamespace ns, const CacheWrite* writes, size_t count, bool* stored);
+
+        // Clés textuelles, converties par CacheKey::FromString
+        bool Put(CacheNamespace ns, const std::string& key, const uint8_t* data, uint32_t length) {
+            return Put(ns, CacheKey::FromString(key), data, length);
+        }
+        CacheHandle Acquire(CacheNamespace ns, const std::string& key) const {
+            return Acquire(ns, CacheKey::FromString(key));
+        }
+        bool Remove(CacheNamespace ns, const std::string& key) {
+            return Remove(ns, CacheKey::FromString(key));
+        }
         void Clear();
 
+        void SetEvictionPolicy(EvictionPolicy policy);
+        EvictionPolicy GetEvictionPolicy() const;
+
+        // flush_interval n'est utilisé qu'en kGroupCommit
+        void SetDurabilityMode(DurabilityMode mode,
+                               std::chrono::milliseconds flush_interval = std::chrono::milliseconds(10));
+        DurabilityMode GetDurabilityMode() const;
+        void Flush();
+
+        // scrub_interval : pause entre deux passes complètes, en kBackground
+        void SetVerifyPolicy(VerifyPolicy policy,
+                             std::chrono::milliseconds scrub_interval = std::chrono::milliseconds(1000));
+        VerifyPolicy GetVerifyPolicy() const;
+
         uint32_t GetEntryCount() const;
-        uint32_t GetUsedSpace() const;
-        uint32_t GetFreeSpace() const;
+        uint32_t GetEntryCount(CacheNamespace ns) const;
+        uint64_t GetNamespaceBytes(CacheNamespace ns) const;
+        uint64_t GetUsedSpace() const;
+        uint64_t GetFreeSpace() const;    // Place restante, croissance du fichier comprise
+        uint64_t GetFileSize() const;
+        // Sans verrou : somme des compteurs de tous les threads
+        CacheStats GetStats() const;
+
+        // Traçage des étapes internes (attente du verrou, vérification du
+        // checksum, synchronisation des pages) : hook(étape, début, fin), en
+        // ns CLOCK_MONOTONIC, appelé par le thread de l'opération. nullptr
+        // (défaut) : désactivé.
+        using TraceHook = void (*)(const char* stage, uint64_t start_ns, uint64_t end_ns);
+        void SetTraceHook(TraceHook hook) { trace_hook_.store(hook, std::memory_order_relaxed); }
+        const std::string& GetFilePath() const { return config_.path; }
         bool IsValid() const;
 
     private:
+        friend class CacheHandle;
+
         SharedCache();
         ~SharedCache();
         SharedCache(const SharedCache&) = delete;
         SharedCache& operator=(const SharedCache&) = delete;
 
+        // Verrouillage RAII ; la prise du verrou d'écriture répare le cache
+        // si l'écrivain précédent est mort en section critique
+        class WriteLock
+        {
+        public:
+            explicit WriteLock(const SharedCache* cache);
+            ~WriteLock();
+        private:
+            const SharedCache* cache_;
+        };
+
+        class ReadLock
+        {
+        public:
+            explicit ReadLock(const SharedCache* cache);
+            ~ReadLock();
+        private:
+            const SharedCache* cache_;
+        };
+
         void EnsureInitialized() const;
         bool InitMmap() const;
         void InitializeCache() const;
+        void RecoverLocked() const;
+        void ClearStalePins() const;
+
+        // Croissance du fichier : l'espace d'adresses est réservé jusqu'à
+        // max_file_size à l'ouverture, le mapping n'est qu'étendu sur place
+        bool GrowFile(uint64_t required) const;
+        bool MapUpTo(uint64_t size) const;
+        void SyncMapping() const;
 
         CacheHeader* GetHeader() const;
         CacheEntryHeader* GetEntries() const;
         CacheEntryHeader* EntryAt(uint32_t index) const;
+        CacheIndexSlot* GetIndex(uint32_t ns) const;
+        uint64_t* GetFreeBitmap() const;
         uint8_t* GetDataArea() const;
 
-        int FindEntry(const std::string& key) const;
+        bool PutLocked(uint32_t ns, const CacheKey& key, const uint8_t* data, uint32_t length);
+        int LookupLocked(uint32_t ns, const CacheKey& key) const;
+
+        static uint32_t HashKey(const CacheKey& key);
+        int FindEntry(uint32_t ns, const CacheKey& key, uint32_t hash,
+                      uint32_t* bucket = nullptr) const;
         int FindFreeEntry() const;
+        void IndexInsert(uint32_t ns, uint32_t hash, uint32_t entry_index) const;
+        void IndexErase(uint32_t ns, uint32_t bucket) const;
+        void MarkSlot(uint32_t entry_index, bool used) const;
         uint32_t CalculateChecksum(const uint8_t* data, uint32_t length) const;
-        bool CompactCache() const;
+        bool NeedsVerification(uint32_t entry_index, uint32_t generation) const;
+        void MarkVerified(uint32_t entry_index, uint32_t generation) const;
+        void ScrubEntry(uint32_t entry_index) const;
+        void ScrubberLoop();
+        void StopScrubber();
+
+        // Allocateur de la zone de données (listes libres ségrégées)
+        CacheBlockHeader* BlockAt(uint64_t offset) const;
+        uint64_t AllocateBlock(uint32_t length) const;
+        void FreeBlock(uint64_t offset) const;
+        void SplitBlock(uint64_t offset, uint64_t size) const;
+        void FreeListPush(uint64_t offset) const;
+        void FreeListRemove(uint64_t offset) const;
+        void ReleaseEntry(uint32_t entry_index, uint32_t bucket) const;
+        void ReclaimEntry(uint32_t entry_index) const;
+        void InvalidateEntry(CacheEntryHeader* entry) const;
+        void Unpin(uint32_t entry_index) const;
+        uint32_t BucketOf(uint32_t entry_index) const;
+
+        // Compteurs d'activité : chaque thread incrémente sa propre ligne
+        enum Counter : uint32_t
+        {
+            kHits, kMisses, kCorruptions, kWrites, kRejectedWrites,
+            kEvictions, kMerges, kFileGrows, kBytesRead, kBytesWritten,
+            kCounterCount,
+        };
+        struct alignas(64) CounterShard
+        {
+            std::atomic<uint64_t> values[kCounterCount];
+        };
+        void Count(Counter counter, uint64_t amount = 1) const;
+
+        // Début d'une étape tracée, 0 si le traçage est désactivé
+        uint64_t TraceStart() const;
+        void TraceEnd(const char* stage, uint64_t start_ns) const;
+
+        // Éviction
+        uint8_t* GetSketch() const;
+        void RecordAccess(uint32_t hash) const;
+        uint32_t EstimateFrequency(uint32_t hash) const;
+        int SelectVictim(uint32_t ns, int exclude) const;
+        bool EvictOne(uint32_t ns, uint32_t candidate_hash, int exclude) const;
+        bool CanReclaim(uint32_t ns, uint64_t size) const;
+
+        // Bitmap de pages, bornée aux mots non nuls pour ne pas parcourir
+        // tout le fichier à chaque écriture
+        struct PageSet
+        {
+            std::vector<uint64_t> words;
+            size_t lo = 0;
+            size_t hi = 0;             // Mots [lo, hi) potentiellement non nuls
+
+            void Reset(size_t page_count);
+            void Add(size_t first, size_t last);
+            void Merge(const PageSet& other);
+            void Clear();
+        };
+
+        // Suivi des pages modifiées
+        void MarkDirty(const void* address, size_t length) const;
+        void CommitDirty() const;
+        void SyncPages(const PageSet& pages) const;
+        void FlusherLoop();
+        void StopFlusher();
 
-        mutable std::mutex mutex_;
+        mutable std::mutex mutex_;                    // Initialisation dans ce processus
+        mutable SharedRwLock lock_;                   // Accès au contenu, entre processus
+        CacheConfig config_;
+        bool configured_ = false;                     // Configure() appelé explicitement
+        mutable CacheLayout layout_;
         mutable void* mmap_base_ = nullptr;
-        mutable size_t mmap_size_ = 0;
-        mutable bool initialized_ = false;
+        mutable size_t reserved_size_ = 0;            // Espace d'adresses réservé
+        mutable std::atomic<uint64_t> mapped_size_{0}; // Partie mappée sur le fichier
+        mutable std::mutex map_mutex_;
+        mutable std::atomic<bool> initialized_{false};
         mutable int fd_ = -1;
+        std::atomic<EvictionPolicy> eviction_policy_{EvictionPolicy::kClock};
+
+        std::atomic<DurabilityMode> durability_mode_{DurabilityMode::kRange};
+        mutable PageSet dirty_pages_;                 // Opération en cours (sous verrou d'écriture)
+        mutable PageSet pending_pages_;               // En attente du flusher (sous flush_mutex_)
+        mutable std::mutex flush_mutex_;
+        std::condition_variable flush_cv_;
+        std::chrono::milliseconds flush_interval_{10};
+        std::thread flusher_;
+        bool flusher_stop_ = false;
+
+        std::atomic<VerifyPolicy> verify_policy_{VerifyPolicy::kAlways};
+        // Génération + 1 de la dernière version vérifiée de chaque slot (0 : jamais)
+        mutable std::unique_ptr<std::atomic<uint32_t>[]> verified_;
+        mutable CounterShard counters_[CACHE_COUNTER_SHARDS] = {};
+        std::atomic<TraceHook> trace_hook_{nullptr};
+        std::mutex scrub_mutex_;
+        std::condition_variable scrub_cv_;
+        std::chrono::milliseconds scrub_interval_{1000};
+        std::thread scrubber_;
+        bool scrubber_stop_ = false;
     };
 
 } // namespace m_cache
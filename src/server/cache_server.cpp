@@ -1,17 +1,27 @@
 #include "cache_server.h"
 #include "../m_cache/m_v8_shared_cache.h"
 #include "../m_cache/m_graph_serializer.h"
+#include <cinttypes>
+#include <algorithm>
+#include <cerrno>
+#include <pthread.h>
+#include <thread>
+
+// Clé de cache d'un hash de fonction reçu dans un champ de taille fixe
+static m_cache::CacheKey function_key(const char* hash, size_t capacity)
+{
+    return m_cache::CacheKey::FromString(hash, strnlen(hash, capacity));
+}
+
+thread_local IPCServer::RequestContext IPCServer::current;
 
-IPCServer::IPCServer() : shared_data(nullptr), running(false) {}
+IPCServer::IPCServer()
+    : shared_data(nullptr), running(false), busy_poll_cpu(-1),
+      worker_count(std::max(1u, std::thread::hardware_concurrency())), shed_depth(IPC_SHED_DEPTH) {}
 
 IPCServer::~IPCServer()
 {
     if (shared_data) {
-        // Nettoyer les sémaphores
-        sem_destroy(&shared_data->mutex);
-        sem_destroy(&shared_data->data_ready);
-        sem_destroy(&shared_data->response_ready);
-
         // Détacher la mémoire partagée
         munmap(shared_data, sizeof(SharedData));
 
@@ -47,20 +57,23 @@ SharedData* IPCServer::create_shared_memory()
         return nullptr;
     }
 
-    // Initialiser les sémaphores (1 = partagé entre processus)
-    if (sem_init(&data->mutex, 1, 1) == -1 ||
-        sem_init(&data->data_ready, 1, 0) == -1 ||
-        sem_init(&data->response_ready, 1, 0) == -1) {
-        perror("sem_init");
-        munmap(data, sizeof(SharedData));
-        return nullptr;
-    }
+    // Un segment laissé par un serveur précédent est remis à zéro (les
+    // événements futex n'ont pas d'autre initialisation)
+    memset(static_cast<void*>(data), 0, sizeof(SharedData));
 
-    // Initialiser les flags
-    data->has_message = false;
-    data->has_response = false;
-    data->message_size = 0;
-    data->response_size = 0;
+    // Chaque case de l'anneau attend d'abord la position égale à son indice
+    for (uint64_t i = 0; i < IPC_RING_SLOTS; ++i) {
+        data->ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    // Bits au-delà du pool marqués pris
+    data->busy_slots.store(IPC_RING_SLOTS == 64 ? 0 : ~((1ULL << (IPC_RING_SLOTS % 64)) - 1),
+        std::memory_order_relaxed);
+    for (IPCSlot& slot : data->slots) {
+        slot.client_id = IPC_MAX_CLIENTS;
+    }
+    data->next_message_id.store(1, std::memory_order_relaxed);
+    data->enqueue_pos.store(0, std::memory_order_relaxed);
+    data->dequeue_pos.store(0, std::memory_order_release);
 
     return data;
 }
@@ -72,6 +85,12 @@ bool IPCServer::initialize()
     if (!shared_data) {
         return false;
     }
+    strncpy(shared_data->cache_path, m_cache::SharedCache::Instance().GetFilePath().c_str(),
+        sizeof(shared_data->cache_path) - 1);
+
+    if (!stats.initialize()) {
+        return false;
+    }
 
     // Configurer les routes
     initialize_routes();
@@ -80,125 +99,156 @@ bool IPCServer::initialize()
 
 void IPCServer::initialize_routes()
 {
-    router.register_route<CreateUserRequest>("user/create",
+    router.register_route<CreateUserRequest>(IPC_ROUTE("user/create"),
         [this](const CreateUserRequest& req) {
             handle_create_user(req);
         });
 
-    router.register_route<GetUserRequest>("user/get",
+    router.register_route<GetUserRequest>(IPC_ROUTE("user/get"),
         [this](const GetUserRequest& req) {
             handle_get_user(req);
         });
 
-    router.register_route<DeleteUserRequest>("user/delete",
+    router.register_route<DeleteUserRequest>(IPC_ROUTE("user/delete"),
         [this](const DeleteUserRequest& req) {
             handle_delete_user(req);
         });
-    router.register_variable_route("function/add_ir_graph",
+    router.register_variable_route(IPC_ROUTE("function/add_ir_graph"),
         [this](const char* data, size_t size) {
-            std::cout << "Handling variable route for function/add_ir_graph" << std::endl;
             handle_add_function_ir_graph(data, size);
         });
-    router.register_route<GetFunctionIRRequest>("function/get_ir",
+    router.register_route<GetFunctionIRRequest>(IPC_ROUTE("function/get_ir"),
         [this](const GetFunctionIRRequest& req) {
-            // Récupérer l'ID du message depuis shared_data
-            uint32_t message_id = shared_data->current_message_id;
+            // ID du message en cours de traitement
+            uint32_t message_id = current.message_id;
             handle_get_function_ir(req, message_id);
         });
-    router.register_route<GetFunctionIRGraphRequest>("function/get_ir_graph",
+    router.register_route<GetFunctionIRGraphRequest>(IPC_ROUTE("function/get_ir_graph"),
         [this](const GetFunctionIRGraphRequest& req) {
-            uint32_t message_id = shared_data->current_message_id;
+            uint32_t message_id = current.message_id;
             handle_get_function_ir_graph(req, message_id);
         });
 
     // Routes pour la gestion du bytecode
-    router.register_variable_route("bytecode/save",
+    router.register_variable_route(IPC_ROUTE("bytecode/save"),
         [this](const char* data, size_t size) {
-            std::cout << "Handling variable route for bytecode/save" << std::endl;
             handle_save_bytecode(data, size);
         });
 
-    router.register_route<GetBytecodeRequest>("bytecode/get",
+    router.register_route<GetBytecodeRequest>(IPC_ROUTE("bytecode/get"),
         [this](const GetBytecodeRequest& req) {
-            uint32_t message_id = shared_data->current_message_id;
+            uint32_t message_id = current.message_id;
             handle_get_bytecode(req, message_id);
         });
+
+    // Lots : une requête et une prise de verrou pour plusieurs clés
+    router.register_variable_route(IPC_ROUTE("bytecode/get_many"),
+        [this](const char* data, size_t size) {
+            handle_get_many(m_cache::CacheNamespace::kBytecode, data, size, current.message_id);
+        });
+    router.register_variable_route(IPC_ROUTE("function/get_ir_graph_many"),
+        [this](const char* data, size_t size) {
+            handle_get_many(m_cache::CacheNamespace::kIRGraph, data, size, current.message_id);
+        });
+    router.register_variable_route(IPC_ROUTE("bytecode/save_many"),
+        [this](const char* data, size_t size) {
+            handle_put_many(m_cache::CacheNamespace::kBytecode, data, size, current.message_id);
+        });
+    router.register_variable_route(IPC_ROUTE("function/add_ir_graph_many"),
+        [this](const char* data, size_t size) {
+            handle_put_many(m_cache::CacheNamespace::kIRGraph, data, size, current.message_id);
+        });
+
+    // Lectures sans copie : le client lit l'entrée dans le fichier de cache
+    router.register_route<GetCacheRefRequest>(IPC_ROUTE("bytecode/get_ref"),
+        [this](const GetCacheRefRequest& req) {
+            handle_get_cache_ref(m_cache::CacheNamespace::kBytecode, req, current.message_id);
+        });
+    router.register_route<GetCacheRefRequest>(IPC_ROUTE("function/get_ir_graph_ref"),
+        [this](const GetCacheRefRequest& req) {
+            handle_get_cache_ref(m_cache::CacheNamespace::kIRGraph, req, current.message_id);
+        });
+
+    // Métriques, aussi lisibles sans requête dans le segment IPC_STATS_NAME
+    router.register_variable_route(IPC_ROUTE("stats/get"),
+        [this](const char*, size_t) {
+            handle_get_stats(current.message_id);
+        });
 }
 
 void IPCServer::handle_create_user(const CreateUserRequest& request)
 {
-    printf("=== CRÉATION UTILISATEUR ===\n");
-    printf("Nom d'utilisateur: %s\n", request.username);
-    printf("Email: %s\n", request.email);
-    printf("Utilisateur créé avec succès!\n\n");
+    LOG_DEBUG("=== CRÉATION UTILISATEUR ===");
+    LOG_DEBUG("Nom d'utilisateur: %s", request.username);
+    LOG_DEBUG("Email: %s", request.email);
+    LOG_DEBUG("Utilisateur créé avec succès!");
 }
 
 void IPCServer::handle_get_user(const GetUserRequest& request)
 {
-    printf("=== RÉCUPÉRATION UTILISATEUR ===\n");
-    printf("ID utilisateur demandé: %u\n", request.user_id);
-    printf("Données utilisateur récupérées!\n\n");
+    LOG_DEBUG("=== RÉCUPÉRATION UTILISATEUR ===");
+    LOG_DEBUG("ID utilisateur demandé: %u", request.user_id);
+    LOG_DEBUG("Données utilisateur récupérées!");
 }
 
 void IPCServer::handle_delete_user(const DeleteUserRequest& request)
 {
-    printf("=== SUPPRESSION UTILISATEUR ===\n");
-    printf("ID utilisateur à supprimer: %u\n", request.user_id);
-    printf("Utilisateur supprimé avec succès!\n\n");
+    LOG_DEBUG("=== SUPPRESSION UTILISATEUR ===");
+    LOG_DEBUG("ID utilisateur à supprimer: %u", request.user_id);
+    LOG_DEBUG("Utilisateur supprimé avec succès!");
 }
 
 void IPCServer::handle_add_function_ir_graph(const char* data, size_t size)
 {
     if (size < sizeof(AddFunctionIRRequest)) {
-        printf("Erreur: données insuffisantes pour AddFunctionIRRequest\n");
+        LOG_ERROR("Erreur: données insuffisantes pour AddFunctionIRRequest");
         return;
     }
-    printf("=== AJOUT GRAPHIQUE IR AVEC CACHE ===\n");
+    LOG_DEBUG("=== AJOUT GRAPHIQUE IR AVEC CACHE ===");
 
     const AddFunctionIRRequest* request = (const AddFunctionIRRequest*)data;
 
-    printf("Hash de la fonction: %s\n", request->function_code_hash);
-    printf("Taille des données sérialisées: %u octets\n", request->serialized_graph_size);
+    LOG_DEBUG("Hash de la fonction: %s", request->function_code_hash);
+    LOG_DEBUG("Taille des données sérialisées: %u octets", request->serialized_graph_size);
 
     // Vérifier la cohérence des tailles
     size_t expected_total_size = sizeof(AddFunctionIRRequest) + request->serialized_graph_size;
     if (size != expected_total_size) {
-        printf("Erreur: taille des données incorrecte\n");
+        LOG_ERROR("Erreur: taille des données incorrecte");
         return;
     }
 
-    try {
-        // Désérialiser le graphique pour validation
-        // v8::internal::compiler::SerializeTFGraph deserialized_graph = v8::internal::compiler::GraphSerializer::deserialize_from_bytes(
-        //     request->serialized_graph, request->serialized_graph_size);
-
-        // Stocker dans le cache partagé
-        m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
+    // Validation sur place : bornes et cohérence du format plat, sans
+    // reconstruire le graphe
+    v8::internal::compiler::FlatGraphView graph;
+    if (!graph.open(request->serialized_graph, request->serialized_graph_size)) {
+        LOG_ERROR("Erreur: graphique IR invalide pour %s", request->function_code_hash);
+        return;
+    }
+    LOG_DEBUG("Graphique IR valide: %u nœuds", graph.node_count());
 
-        if (cache.Put(std::string(request->function_code_hash),
-            request->serialized_graph, request->serialized_graph_size)) {
-            printf("Graphique IR stocké dans le cache avec succès!\n");
-            printf("- Entrées dans le cache: %u\n", cache.GetEntryCount());
-            printf("- Espace utilisé: %u octets\n", cache.GetUsedSpace());
-        }
-        else {
-            printf("Erreur: impossible de stocker dans le cache\n");
-        }
+    // Stocker dans le cache partagé
+    m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
 
+    if (cache.Put(m_cache::CacheNamespace::kIRGraph,
+        function_key(request->function_code_hash, sizeof(request->function_code_hash)),
+        request->serialized_graph, request->serialized_graph_size)) {
+        LOG_DEBUG("Graphique IR stocké dans le cache avec succès!");
+        LOG_DEBUG("- Entrées dans le cache: %u", cache.GetEntryCount());
+        LOG_DEBUG("- Espace utilisé: %" PRIu64 " octets", cache.GetUsedSpace());
     }
-    catch (const std::exception& e) {
-        printf("Erreur de désérialisation: %s\n", e.what());
+    else {
+        LOG_ERROR("Erreur: impossible de stocker dans le cache");
     }
 
-    printf("\n");
 }
 
 
 void IPCServer::handle_get_function_ir(const GetFunctionIRRequest& request,
     uint32_t message_id)
 {
-    printf("=== RÉCUPÉRATION IR FONCTION ===\n");
-    printf("Hash demandé: %s\n", request.function_code_hash);
+    LOG_DEBUG("=== RÉCUPÉRATION IR FONCTION ===");
+    LOG_DEBUG("Hash demandé: %s", request.function_code_hash);
 
     // Simuler la recherche de la fonction
     // Dans une vraie application, vous chercheriez dans une base de données
@@ -208,23 +258,18 @@ void IPCServer::handle_get_function_ir(const GetFunctionIRRequest& request,
         uint8_t sample_ir[] = { 0x48, 0x89, 0xe5, 0x48, 0x83, 0xec, 0x10, 0xc7, 0x45, 0xfc };
         uint32_t num_bits = 80; // 10 octets * 8 bits
 
-        // Calculer la taille totale de la réponse
-        size_t response_size = sizeof(GetFunctionIRResponse) + sizeof(sample_ir);
-
-        // Allouer temporairement la réponse
-        uint8_t* buffer = new uint8_t[response_size];
-        GetFunctionIRResponse* response = (GetFunctionIRResponse*)buffer;
-
-        response->success = true;
-        response->bit_array_size = num_bits;
-        strcpy(response->error_message, "");
-        memcpy(response->bit_array, sample_ir, sizeof(sample_ir));
-
-        // Envoyer la réponse
-        send_response(message_id, response, response_size);
+        // Réponse écrite directement dans le slot
+        GetFunctionIRResponse* response =
+            reserve_response<GetFunctionIRResponse>(message_id, sizeof(sample_ir));
+        if (response) {
+            response->success = true;
+            response->bit_array_size = num_bits;
+            strcpy(response->error_message, "");
+            memcpy(response->bit_array, sample_ir, sizeof(sample_ir));
+            commit_response();
+        }
 
-        printf("IR envoyé: %u bits\n", num_bits);
-        delete[] buffer;
+        LOG_DEBUG("IR envoyé: %u bits", num_bits);
 
     }
     else {
@@ -235,55 +280,49 @@ void IPCServer::handle_get_function_ir(const GetFunctionIRRequest& request,
         strcpy(response.error_message, "Fonction non trouvée");
 
         send_response(message_id, &response, sizeof(response));
-        printf("Fonction non trouvée\n");
+        LOG_DEBUG("Fonction non trouvée");
     }
 
-    printf("\n");
 }
 
 void IPCServer::handle_get_function_ir_graph(const GetFunctionIRGraphRequest& request,
     uint32_t message_id)
 {
-    printf("=== RÉCUPÉRATION GRAPHIQUE IR ===\n");
-    printf("Hash de la fonction demandée: %s\n", request.function_code_hash);
+    LOG_DEBUG("=== RÉCUPÉRATION GRAPHIQUE IR ===");
+    LOG_DEBUG("Hash de la fonction demandée: %s", request.function_code_hash);
 
     // Rechercher dans le cache partagé
     m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
 
-    const uint8_t* cached_data = nullptr;
-    uint32_t cached_size = 0;
-
-    if (cache.Get(std::string(request.function_code_hash), &cached_data, cached_size)) {
-        printf("Graphique trouvé dans le cache (%u octets)\n", cached_size);
-
-        // Créer la réponse avec les données du cache
-        size_t response_size = sizeof(GetFunctionIRGraphResponse) + cached_size;
-
-        // Allouer temporairement la réponse
-        uint8_t* buffer = new uint8_t[response_size];
-        GetFunctionIRGraphResponse* response = (GetFunctionIRGraphResponse*)buffer;
-
-        response->success = true;
-        response->serialized_graph_size = cached_size;
-        strcpy(response->error_message, "");
-
-        // Copier les données sérialisées du cache
-        memcpy(response->serialized_graph, cached_data, cached_size);
+    // Le handle garde les octets en place le temps de les copier dans la réponse
+    m_cache::CacheHandle cached = cache.Acquire(m_cache::CacheNamespace::kIRGraph,
+        function_key(request.function_code_hash, sizeof(request.function_code_hash)));
+
+    if (cached) {
+        LOG_DEBUG("Graphique trouvé dans le cache (%u octets)", cached.size());
+
+        // En-tête et graphe écrits directement dans le slot : une seule copie
+        // depuis le cache
+        GetFunctionIRGraphResponse* response =
+            reserve_response<GetFunctionIRGraphResponse>(message_id, cached.size());
+        if (response) {
+            response->success = true;
+            response->serialized_graph_size = cached.size();
+            strcpy(response->error_message, "");
+            memcpy(response->serialized_graph, cached.data(), cached.size());
+        }
 
-        // Envoyer la réponse
-        if (send_response(message_id, response, response_size)) {
-            printf("Graphique IR envoyé avec succès au client\n");
+        if (response && commit_response()) {
+            LOG_DEBUG("Graphique IR envoyé avec succès au client");
         }
-        else {
-            printf("Erreur: impossible d'envoyer la réponse\n");
+        else if (!current.responded) {
+            LOG_ERROR("Erreur: impossible d'envoyer la réponse");
         }
 
-        delete[] buffer;
-
     }
     else {
         // Fonction non trouvée dans le cache
-        printf("Fonction non trouvée dans le cache\n");
+        LOG_DEBUG("Fonction non trouvée dans le cache");
 
         GetFunctionIRGraphResponse response;
         response.success = false;
@@ -293,186 +332,410 @@ void IPCServer::handle_get_function_ir_graph(const GetFunctionIRGraphRequest& re
         send_response(message_id, &response, sizeof(response));
     }
 
-    printf("\n");
 }
 
 bool IPCServer::send_response(uint32_t message_id, const void* response_data,
     size_t response_size)
 {
-    if (response_size > MAX_MESSAGE_SIZE) {
-        printf("Erreur: Réponse trop volumineuse\n");
+    return send_response(message_id, response_data, response_size, nullptr, 0);
+}
+
+bool IPCServer::send_response(uint32_t message_id, const void* header, size_t header_size,
+    const void* payload, size_t payload_size)
+{
+    if (current.slot && !current.responded && !(current.slot->flags & IPC_SLOT_EXPECTS_RESPONSE)) {
+        // Le client n'attend rien : le slot sera rendu après le traitement
+        current.responded = true;
+        return true;
+    }
+    char* out = static_cast<char*>(reserve_response(message_id, header_size + payload_size));
+    if (!out) {
         return false;
     }
+    if (header_size > 0) {
+        memcpy(out, header, header_size);
+    }
+    if (payload_size > 0) {
+        memcpy(out + header_size, payload, payload_size);
+    }
+    return commit_response();
+}
 
-    // Copier la réponse dans le buffer partagé
-    memcpy(shared_data->response, response_data, response_size);
-    shared_data->response_size = response_size;
-    shared_data->response_message_id = message_id;
-    shared_data->has_response = true;
+void* IPCServer::reserve_response(uint32_t message_id, size_t size)
+{
+    if (!current.slot || current.responded || current.reserved) {
+        LOG_ERROR("Erreur: aucune requête en attente de réponse");
+        return nullptr;
+    }
+    // Le client n'attend rien : le slot sera rendu après le traitement
+    if (!(current.slot->flags & IPC_SLOT_EXPECTS_RESPONSE)) {
+        current.responded = true;
+        return nullptr;
+    }
 
-    // Signaler au client que la réponse est prête
-    sem_post(&shared_data->response_ready);
+    // Réponse dans le slot de la requête, ou dans un segment dédié quand
+    // elle ne tient pas dans le slot
+    char* out = current.slot->response;
+    current.slot->response_flags = 0;
+    if (size > MAX_MESSAGE_SIZE) {
+        if (size > UINT32_MAX) {
+            LOG_ERROR("Erreur: Réponse trop volumineuse");
+            return nullptr;
+        }
+        ipc_external_init(&current.slot->response_external, "resp", message_id, size);
+        out = static_cast<char*>(ipc_external_create(current.slot->response_external));
+        if (!out) {
+            LOG_ERROR("Erreur: impossible de créer le segment de réponse");
+            return nullptr;
+        }
+        current.slot->response_flags = IPC_RESPONSE_EXTERNAL;
+    }
+    current.reserved = out;
+    current.reserved_size = size;
+    current.reserved_id = message_id;
+    current.reserved_ns = IPCTrace::start();
+    return out;
+}
 
+bool IPCServer::commit_response()
+{
+    if (!current.reserved) {
+        LOG_ERROR("Erreur: aucune réponse réservée");
+        return false;
+    }
+    if (current.reserved != current.slot->response) {
+        munmap(current.reserved, current.reserved_size);
+    }
+    current.slot->response_size = current.reserved_size;
+    current.slot->response_message_id = current.reserved_id;
+    current.reserved = nullptr;
+    IPCTrace::finish("server.response", current.reserved_ns, current.reserved_id);
+    // Le slot n'est complété qu'à la fin du traitement : le handler peut
+    // encore lire sa requête après avoir répondu
+    current.responded = true;
     return true;
 }
+
+void IPCServer::discard_response()
+{
+    if (!current.reserved) {
+        return;
+    }
+    if (current.reserved != current.slot->response) {
+        munmap(current.reserved, current.reserved_size);
+        shm_unlink(current.slot->response_external.name);
+    }
+    current.slot->response_flags = 0;
+    current.reserved = nullptr;
+}
+
+void IPCServer::trace_cache(const char* stage, uint64_t start_ns, uint64_t end_ns)
+{
+    IPCTrace::record(stage, start_ns, end_ns, current.message_id);
+}
+
+void IPCServer::process_slot(uint32_t index)
+{
+    const uint64_t picked = IPCTrace::start();
+    IPCSlot& slot = shared_data->slots[index];
+    IPCMessage* message = (IPCMessage*)slot.message;
+
+    // Relevés avant de compléter le slot : le client peut le rendre et un
+    // autre le reprendre dès que l'état passe à COMPLETED
+    const uint32_t flags = slot.flags;
+    const uint32_t client_id = slot.client_id;
+    const uint32_t client_generation = slot.client_generation;
+
+    current.slot = &slot;
+    current.message_id = message->message_id;
+    current.responded = false;
+
+    // Attente dans l'anneau, depuis la publication par un client qui trace
+    if (picked != 0 && slot.published_ns != 0) {
+        IPCTrace::record("server.queue", slot.published_ns, picked, current.message_id, IPC_TRACE_FLOW_END);
+    }
+
+    // Charge utile dans le slot, ou dans le segment dédié du client ; dans ce
+    // cas les handlers la lisent directement dans le mapping
+    const char* payload = message->payload;
+    void* external = nullptr;
+    bool valid = slot.message_size >= sizeof(IPCMessage);
+    if (valid && (flags & IPC_SLOT_EXTERNAL_PAYLOAD)) {
+        external = ipc_external_open(slot.external);
+        payload = static_cast<const char*>(external);
+        valid = external != nullptr && slot.external.size == message->payload_size;
+    }
+    else if (valid) {
+        valid = message->payload_size <= slot.message_size - sizeof(IPCMessage);
+    }
+
+    // Réponse devenue inutile : abandonnée par le client, échéance passée,
+    // ou basse priorité alors que la file déborde. Le moteur compile alors
+    // lui-même au lieu d'attendre.
+    uint32_t shed = 0;
+    if (valid) {
+        if (slot.state.load(std::memory_order_acquire) == IPC_SLOT_CANCELLED ||
+            (message->deadline_ns != 0 && ipc_now_ns() >= message->deadline_ns)) {
+            shed = IPC_RESPONSE_EXPIRED;
+        }
+        else if (message->priority < IPC_PRIORITY_NORMAL && ipc_queue_depth(shared_data) > shed_depth) {
+            shed = IPC_RESPONSE_OVERLOADED;
+        }
+    }
+
+    IPCRouteStats* route_stats = valid && message->route_id < IPC_ROUTE_COUNT ?
+        &current.stats->routes[message->route_id] : nullptr;
+    if (!valid) {
+        LOG_ERROR("Erreur: message mal formé (slot %u)", index);
+    }
+    else if (shed) {
+        LOG_DEBUG("Requête %u rejetée: %s", message->message_id,
+            shed == IPC_RESPONSE_EXPIRED ? "échéance dépassée" : "surcharge");
+        if (route_stats) {
+            (shed == IPC_RESPONSE_EXPIRED ? route_stats->expired : route_stats->overloaded)
+                .fetch_add(1, std::memory_order_relaxed);
+        }
+        slot.response_flags = shed;
+        slot.response_size = 0;
+        slot.response_message_id = message->message_id;
+        current.responded = true;
+    }
+    else {
+        LOG_DEBUG("Message reçu: ID %u, Route %s, Taille %u", message->message_id,
+            route_stats ? IPC_ROUTE_NAMES[message->route_id] : "inconnue", message->payload_size);
+        uint64_t started = ipc_now_ns();
+        router.dispatch_message(message, payload, message->payload_size);
+        uint64_t finished = ipc_now_ns();
+        if (route_stats) {
+            IPCStats::record(*route_stats, finished - started);
+            if (picked != 0) {
+                IPCTrace::record(IPC_ROUTE_NAMES[message->route_id], started, finished, current.message_id);
+            }
+        }
+    }
+    if (external) {
+        munmap(external, slot.external.size);
+    }
+
+    // Chaque slot est complété : réponse vide si le handler n'a rien envoyé,
+    // pour que le client ne reste pas bloqué
+    discard_response();
+    if (!current.responded) {
+        send_response(current.message_id, nullptr, 0);
+    }
+    current.slot = nullptr;
+    if (!(flags & IPC_SLOT_EXPECTS_RESPONSE)) {
+        ipc_slot_free(shared_data, index);
+        IPCTrace::finish("server.request", picked, current.message_id);
+        return;
+    }
+
+    // Publier la réponse et réveiller le client dans sa boîte ; s'il y a
+    // renoncé ou est parti entre-temps, personne ne la lira et le slot est rendu ici
+    const uint64_t completing = IPCTrace::start();
+    if (ipc_slot_complete(shared_data, slot)) {
+        if (ipc_mailbox_current(shared_data, client_id, client_generation)) {
+            ipc_event_signal(&shared_data->mailboxes[client_id].ready);
+        }
+        else {
+            ipc_slot_consume(shared_data, slot);
+        }
+    }
+    IPCTrace::finish("server.complete", completing, current.message_id);
+    IPCTrace::finish("server.request", picked, current.message_id);
+}
+
 void IPCServer::run()
 {
     if (!initialize()) {
-        fprintf(stderr, "Erreur lors de l'initialisation du serveur\n");
+        LOG_ERROR("Erreur lors de l'initialisation du serveur");
         return;
     }
 
-    printf("=== SERVEUR IPC DÉMARRÉ ===\n");
-    printf("En attente de messages...\n\n");
+    LOG_INFO("=== SERVEUR IPC DÉMARRÉ ===");
+    LOG_INFO("%u worker(s)", worker_count);
+    if (busy_poll_cpu >= 0) {
+        LOG_INFO("Attente active à partir du cœur %d", busy_poll_cpu);
+    }
+    LOG_INFO("En attente de messages...");
+
+    if (!trace_path.empty()) {
+        IPCTrace::enable();
+        m_cache::SharedCache::Instance().SetTraceHook(&IPCServer::trace_cache);
+        LOG_INFO("Traçage des requêtes vers %s", trace_path.c_str());
+    }
 
     running = true;
+    stats.start();
+
+    // Le thread appelant sert de premier worker
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < worker_count; ++i) {
+        workers.emplace_back(&IPCServer::worker_loop, this, i);
+    }
+    worker_loop(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    stats.stop();
+    if (!trace_path.empty()) {
+        m_cache::SharedCache::Instance().SetTraceHook(nullptr);
+        IPCTrace::dump(trace_path.c_str(), "cache_server");
+    }
+
+    LOG_INFO("Serveur arrêté.");
+}
+
+void IPCServer::worker_loop(unsigned worker)
+{
+    current.stats = stats.shard(worker);
+
+    if (busy_poll_cpu >= 0) {
+        // Le worker occupe son cœur en permanence : l'épingler évite de le
+        // voir migrer et de perdre ses caches. Au-delà du dernier cœur en
+        // ligne, on repart du premier.
+        long online = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+        int cpu = static_cast<int>((busy_poll_cpu + worker) % std::min<long>(online, CPU_SETSIZE));
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            LOG_WARN("Impossible d'épingler le worker %u sur le cœur %d: %s",
+                worker, cpu, strerror(err));
+        }
+    }
 
+    IPCSpinBudget spin;
     while (running) {
-        // Attendre qu'un message arrive
-        sem_wait(&shared_data->data_ready);
-
-        std::cout << "Running..." << std::endl;
-
-        if (!running) break;
-        printf("SERVEUR: has_message lu comme %s, adresse: %p\n",
-            shared_data->has_message ? "true" : "false",
-            &shared_data->has_message);
-
-        if (shared_data->has_message) {
-            std::cout << "Message reçu, traitement en cours..." << std::endl;
-            // Traiter le message
-            IPCMessage* message = (IPCMessage*)shared_data->message;
-            std::cout << "Message reçu: ID " << message->message_id
-                << ", Route hash " << message->route_hash
-                << ", Taille " << message->payload_size << std::endl;
-            router.dispatch_message(message);
-
-            // Marquer le message comme traité
-            shared_data->has_message = false;
+        // Séquence lue avant de vider l'anneau : une publication qui suit
+        // ne peut pas être manquée
+        uint32_t seen = ipc_event_prepare(&shared_data->data_ready);
+
+        // Vider l'anneau avec les autres workers : une requête publiée avant
+        // une position encore en cours d'écriture sera prise au signal suivant
+        uint32_t index;
+        bool idle = true;
+        while (ipc_ring_take(shared_data, &index)) {
+            process_slot(index);
+            idle = false;
         }
 
-        // Libérer le mutex pour permettre de nouveaux messages
-        sem_post(&shared_data->mutex);
+        if (!idle) continue;
+        if (busy_poll_cpu >= 0) {
+            ipc_cpu_relax();
+        }
+        else {
+            ipc_event_wait(&shared_data->data_ready, seen, &spin);
+        }
     }
-
-    printf("Serveur arrêté.\n");
 }
 
 void IPCServer::handle_save_bytecode(const char* data, size_t size)
 {
     if (size < sizeof(SaveBytecodeRequest)) {
-        printf("Erreur: données insuffisantes pour SaveBytecodeRequest\n");
+        LOG_ERROR("Erreur: données insuffisantes pour SaveBytecodeRequest");
         return;
     }
     
-    printf("=== SAUVEGARDE BYTECODE ===\n");
+    LOG_DEBUG("=== SAUVEGARDE BYTECODE ===");
     
     const SaveBytecodeRequest* request = (const SaveBytecodeRequest*)data;
     
-    printf("Hash de la fonction: %s\n", request->function_code_hash);
-    printf("Taille du bytecode: %u octets\n", request->bytecode_size);
+    LOG_DEBUG("Hash de la fonction: %s", request->function_code_hash);
+    LOG_DEBUG("Taille du bytecode: %u octets", request->bytecode_size);
     
     // Vérifier la cohérence des tailles
     size_t expected_total_size = sizeof(SaveBytecodeRequest) + request->bytecode_size;
     if (size != expected_total_size) {
-        printf("Erreur: taille des données incorrecte (reçu: %zu, attendu: %zu)\n", size, expected_total_size);
+        LOG_ERROR("Erreur: taille des données incorrecte (reçu: %zu, attendu: %zu)", size, expected_total_size);
         
         SaveBytecodeResponse response;
         response.success = false;
         strcpy(response.error_message, "Taille des données incorrecte");
         
-        uint32_t message_id = shared_data->current_message_id;
+        uint32_t message_id = current.message_id;
         send_response(message_id, &response, sizeof(response));
         return;
     }
     
     try {
-        // Stocker le bytecode dans le cache partagé avec un préfixe pour le distinguer des graphiques IR
-        std::string bytecode_key = "bytecode_" + std::string(request->function_code_hash);
-        
+        // Stocker le bytecode dans son propre espace du cache partagé
         m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
         
-        if (cache.Put(bytecode_key, request->bytecode, request->bytecode_size)) {
-            printf("Bytecode stocké dans le cache avec succès!\n");
-            printf("- Entrées dans le cache: %u\n", cache.GetEntryCount());
-            printf("- Espace utilisé: %u octets\n", cache.GetUsedSpace());
+        if (cache.Put(m_cache::CacheNamespace::kBytecode,
+            function_key(request->function_code_hash, sizeof(request->function_code_hash)),
+            request->bytecode, request->bytecode_size)) {
+            LOG_DEBUG("Bytecode stocké dans le cache avec succès!");
+            LOG_DEBUG("- Entrées dans le cache: %u", cache.GetEntryCount());
+            LOG_DEBUG("- Espace utilisé: %" PRIu64 " octets", cache.GetUsedSpace());
             
             SaveBytecodeResponse response;
             response.success = true;
             strcpy(response.error_message, "");
             
-            uint32_t message_id = shared_data->current_message_id;
+            uint32_t message_id = current.message_id;
             send_response(message_id, &response, sizeof(response));
         }
         else {
-            printf("Erreur: impossible de stocker le bytecode dans le cache\n");
+            LOG_ERROR("Erreur: impossible de stocker le bytecode dans le cache");
             
             SaveBytecodeResponse response;
             response.success = false;
             strcpy(response.error_message, "Impossible de stocker dans le cache");
             
-            uint32_t message_id = shared_data->current_message_id;
+            uint32_t message_id = current.message_id;
             send_response(message_id, &response, sizeof(response));
         }
     }
     catch (const std::exception& e) {
-        printf("Erreur lors de la sauvegarde du bytecode: %s\n", e.what());
+        LOG_ERROR("Erreur lors de la sauvegarde du bytecode: %s", e.what());
         
         SaveBytecodeResponse response;
         response.success = false;
         snprintf(response.error_message, sizeof(response.error_message), 
                  "Erreur interne: %s", e.what());
         
-        uint32_t message_id = shared_data->current_message_id;
+        uint32_t message_id = current.message_id;
         send_response(message_id, &response, sizeof(response));
     }
     
-    printf("\n");
 }
 
 void IPCServer::handle_get_bytecode(const GetBytecodeRequest& request, uint32_t message_id)
 {
-    printf("=== RÉCUPÉRATION BYTECODE ===\n");
-    printf("Hash de la fonction demandée: %s\n", request.function_code_hash);
-    
-    // Rechercher dans le cache partagé avec le préfixe bytecode
-    std::string bytecode_key = "bytecode_" + std::string(request.function_code_hash);
+    LOG_DEBUG("=== RÉCUPÉRATION BYTECODE ===");
+    LOG_DEBUG("Hash de la fonction demandée: %s", request.function_code_hash);
     
+    // Rechercher dans l'espace bytecode du cache partagé
     m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
     
-    const uint8_t* cached_data = nullptr;
-    uint32_t cached_size = 0;
+    m_cache::CacheHandle cached = cache.Acquire(m_cache::CacheNamespace::kBytecode,
+        function_key(request.function_code_hash, sizeof(request.function_code_hash)));
     
-    if (cache.Get(bytecode_key, &cached_data, cached_size)) {
-        printf("Bytecode trouvé dans le cache (%u octets)\n", cached_size);
-        
-        // Créer la réponse avec les données du cache
-        size_t response_size = sizeof(GetBytecodeResponse) + cached_size;
-        
-        // Allouer temporairement la réponse
-        uint8_t* buffer = new uint8_t[response_size];
-        GetBytecodeResponse* response = (GetBytecodeResponse*)buffer;
+    if (cached) {
+        LOG_DEBUG("Bytecode trouvé dans le cache (%u octets)", cached.size());
         
-        response->success = true;
-        response->bytecode_size = cached_size;
-        strcpy(response->error_message, "");
-        
-        // Copier les données du bytecode depuis le cache
-        memcpy(response->bytecode, cached_data, cached_size);
+        // Réponse construite dans le slot, bytecode copié une seule fois
+        GetBytecodeResponse* response =
+            reserve_response<GetBytecodeResponse>(message_id, cached.size());
+        if (response) {
+            response->success = true;
+            response->bytecode_size = cached.size();
+            strcpy(response->error_message, "");
+            memcpy(response->bytecode, cached.data(), cached.size());
+        }
         
-        // Envoyer la réponse
-        if (send_response(message_id, response, response_size)) {
-            printf("Bytecode envoyé avec succès au client\n");
+        if (response && commit_response()) {
+            LOG_DEBUG("Bytecode envoyé avec succès au client");
         }
-        else {
-            printf("Erreur: impossible d'envoyer la réponse\n");
+        else if (!current.responded) {
+            LOG_ERROR("Erreur: impossible d'envoyer la réponse");
         }
-        
-        delete[] buffer;
     }
     else {
         // Bytecode non trouvé dans le cache
-        printf("Bytecode non trouvé dans le cache\n");
+        LOG_DEBUG("Bytecode non trouvé dans le cache");
         
         GetBytecodeResponse response;
         response.success = false;
@@ -482,11 +745,147 @@ void IPCServer::handle_get_bytecode(const GetBytecodeRequest& request, uint32_t
         send_response(message_id, &response, sizeof(response));
     }
     
-    printf("\n");
+}
+
+void IPCServer::handle_get_cache_ref(m_cache::CacheNamespace ns, const GetCacheRefRequest& request,
+    uint32_t message_id)
+{
+    LOG_DEBUG("=== RÉFÉRENCE CACHE ===");
+    LOG_DEBUG("Hash de la fonction demandée: %s", request.function_code_hash);
+
+    GetCacheRefResponse response;
+    memset(&response, 0, sizeof(response));
+
+    // Rien n'est épinglé : le client revalide la génération après sa lecture
+    m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
+    response.success = cache.Locate(ns,
+        function_key(request.function_code_hash, sizeof(request.function_code_hash)), &response.ref);
+    if (response.success) {
+        LOG_DEBUG("Entrée trouvée: offset %" PRIu64 ", %u octets", response.ref.offset, response.ref.length);
+    }
+    else {
+        strcpy(response.error_message, "Entrée non trouvée dans le cache");
+        LOG_DEBUG("Entrée non trouvée dans le cache");
+    }
+
+    send_response(message_id, &response, sizeof(response));
+}
+
+void IPCServer::handle_get_stats(uint32_t message_id)
+{
+    GetStatsResponse* response = reserve_response<GetStatsResponse>(message_id);
+    if (response) {
+        stats.summarize(response);
+        commit_response();
+    }
+}
+
+void IPCServer::handle_get_many(m_cache::CacheNamespace ns, const char* data, size_t size,
+    uint32_t message_id)
+{
+    LOG_DEBUG("=== LECTURE GROUPÉE ===");
+
+    // Découper les hashes ; une requête tronquée reçoit une réponse vide
+    std::vector<m_cache::CacheKey> keys;
+    const GetManyRequest* request = (const GetManyRequest*)data;
+    bool valid = size >= sizeof(GetManyRequest);
+    if (valid) {
+        const char* hash = request->function_code_hashes;
+        const char* end = data + size;
+        keys.reserve(std::min<size_t>(request->count, size));
+        for (uint32_t i = 0; valid && i < request->count; ++i) {
+            const char* terminator = (const char*)memchr(hash, '\0', end - hash);
+            valid = terminator != nullptr;
+            if (valid) {
+                keys.push_back(m_cache::CacheKey::FromString(hash, terminator - hash));
+                hash = terminator + 1;
+            }
+        }
+    }
+    if (!valid) {
+        LOG_ERROR("Erreur: requête groupée mal formée");
+        keys.clear();
+    }
+
+    // Une seule prise du verrou : les clés sont cherchées, la réponse
+    // réservée à la taille exacte, puis remplie sur place
+    const size_t header_size = sizeof(GetManyResponse) + keys.size() * sizeof(GetManyEntry);
+    GetManyResponse* response = nullptr;
+    size_t used = header_size;
+    uint32_t found = m_cache::SharedCache::Instance().ReadMany(ns, keys.data(), keys.size(),
+        [&](uint64_t payload_size) {
+            response = (GetManyResponse*)reserve_response(message_id, header_size + payload_size);
+            if (!response) return false;
+            response->count = keys.size();
+            response->found = 0;
+            for (uint32_t i = 0; i < response->count; ++i) {
+                response->entries[i] = GetManyEntry{IPC_BATCH_NOT_FOUND, 0, 0};
+            }
+            return true;
+        },
+        [&](size_t i, const uint8_t* bytes, uint32_t length) {
+            // Descripteurs puis données, dans l'ordre de la requête
+            response->entries[i] = GetManyEntry{IPC_BATCH_FOUND, length, used};
+            memcpy((char*)response + used, bytes, length);
+            used += length;
+        });
+    if (!response) {
+        return;
+    }
+    response->found = found;
+    LOG_DEBUG("%u clés trouvées sur %u (%zu octets)", response->found, response->count, used - header_size);
+
+    commit_response();
+}
+
+void IPCServer::handle_put_many(m_cache::CacheNamespace ns, const char* data, size_t size,
+    uint32_t message_id)
+{
+    LOG_DEBUG("=== ÉCRITURE GROUPÉE ===");
+
+    const PutManyRequest* request = (const PutManyRequest*)data;
+    uint32_t count = 0;
+    size_t table_size = 0;
+    if (size >= sizeof(PutManyRequest) &&
+        request->count <= (size - sizeof(PutManyRequest)) / sizeof(PutManyEntry)) {
+        count = request->count;
+        table_size = sizeof(PutManyRequest) + count * sizeof(PutManyEntry);
+    }
+    else {
+        LOG_ERROR("Erreur: requête groupée mal formée");
+    }
+
+    // Une entrée dont les données sortent de la requête est refusée seule
+    const uint8_t* values = (const uint8_t*)data + table_size;
+    const size_t values_size = size - table_size;
+    std::vector<m_cache::CacheWrite> writes(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const PutManyEntry& entry = request->entries[i];
+        writes[i].key = function_key(entry.function_code_hash, sizeof(entry.function_code_hash));
+        bool in_bounds = entry.data_offset <= values_size && entry.size <= values_size - entry.data_offset;
+        writes[i].data = in_bounds ? values + entry.data_offset : nullptr;
+        writes[i].length = in_bounds ? entry.size : 0;
+    }
+
+    std::unique_ptr<bool[]> stored(new bool[count]);
+    uint32_t stored_count = m_cache::SharedCache::Instance().PutMany(ns, writes.data(), count, stored.get());
+    LOG_DEBUG("%u entrées écrites sur %u", stored_count, count);
+
+    // Statuts écrits directement dans le slot
+    PutManyResponse* response = reserve_response<PutManyResponse>(message_id, count);
+    if (!response) {
+        return;
+    }
+    response->count = count;
+    response->stored = stored_count;
+    for (uint32_t i = 0; i < count; ++i) {
+        response->status[i] = stored[i] ? IPC_BATCH_FOUND : IPC_BATCH_FAILED;
+    }
+    commit_response();
 }
 
 void IPCServer::stop()
 {
     running = false;
-    sem_post(&shared_data->data_ready); // Débloquer la boucle principale
+    ipc_event_signal(&shared_data->data_ready); // Débloquer tous les workers
 }
@@ -4,13 +4,34 @@
 
 #include "common.h"
 #include "router.h"
+#include "stats.h"
+#include "trace.h"
 
 class IPCServer
 {
 private:
     IPCRouter router;
+    IPCStats stats;
     SharedData* shared_data;
-    bool running;
+    std::atomic<bool> running;     // Remis à false par stop(), depuis un signal
+    int busy_poll_cpu;             // -1 : attente futex, sinon attente active à partir de ce cœur
+    unsigned worker_count;         // Threads qui prennent les requêtes dans l'anneau
+    unsigned shed_depth;           // File d'attente au-delà de laquelle IPC_PRIORITY_LOW est rejetée
+    std::string trace_path;        // Trace Chrome écrite à l'arrêt, vide : pas de traçage
+
+    // Requête en cours de traitement par le thread courant
+    struct RequestContext
+    {
+        IPCSlot* slot = nullptr;
+        uint32_t message_id = 0;
+        bool responded = false;
+        char* reserved = nullptr;  // Réponse réservée, pas encore validée
+        size_t reserved_size = 0;
+        uint32_t reserved_id = 0;
+        IPCStatsShard* stats = nullptr; // Métriques du worker
+        uint64_t reserved_ns = 0;  // Début de la construction de la réponse (traçage)
+    };
+    static thread_local RequestContext current;
 
     // Fonctions de gestion des requêtes
     void handle_create_user(const CreateUserRequest& request);
@@ -21,9 +42,39 @@ private:
     void handle_get_function_ir_graph(const GetFunctionIRGraphRequest& request, uint32_t message_id);
     void handle_save_bytecode(const char* data, size_t size);
     void handle_get_bytecode(const GetBytecodeRequest& request, uint32_t message_id);
+    void handle_get_many(m_cache::CacheNamespace ns, const char* data, size_t size, uint32_t message_id);
+    void handle_put_many(m_cache::CacheNamespace ns, const char* data, size_t size, uint32_t message_id);
+    void handle_get_cache_ref(m_cache::CacheNamespace ns, const GetCacheRefRequest& request,
+        uint32_t message_id);
+    void handle_get_stats(uint32_t message_id);
+
+    // Réponse construite sur place : reserve_response donne `size` octets
+    // dans le slot (ou dans un segment dédié au-delà de sa capacité), que le
+    // handler remplit avant commit_response. nullptr si le client n'attend
+    // pas de réponse ou en cas d'échec : il n'y a alors rien à écrire.
+    void* reserve_response(uint32_t message_id, size_t size);
+    template<typename Header>
+    Header* reserve_response(uint32_t message_id, size_t payload_size = 0)
+    {
+        return static_cast<Header*>(reserve_response(message_id, sizeof(Header) + payload_size));
+    }
+    bool commit_response();
+    // Réservation abandonnée (handler en échec)
+    void discard_response();
 
     // Méthode pour envoyer une réponse
     bool send_response(uint32_t message_id, const void* response_data, size_t response_size);
+    // En-tête et charge utile copiés directement à la suite dans le buffer partagé
+    bool send_response(uint32_t message_id, const void* header, size_t header_size,
+        const void* payload, size_t payload_size);
+
+    // Étapes internes du cache, rattachées à la requête du thread
+    static void trace_cache(const char* stage, uint64_t start_ns, uint64_t end_ns);
+
+    // Traite la requête d'un slot publié puis le complète
+    void process_slot(uint32_t index);
+    // Boucle d'un worker : vide l'anneau, puis attend la publication suivante
+    void worker_loop(unsigned worker);
 
     // Initialisation des routes
     void initialize_routes();
@@ -36,6 +87,14 @@ public:
     ~IPCServer();
 
     bool initialize();
+    // Avant run() : les workers ne dorment plus, le worker i reste épinglé sur `cpu` + i
+    void set_busy_poll(int cpu) { busy_poll_cpu = cpu; }
+    // Avant run() : nombre de workers (au moins 1)
+    void set_worker_count(unsigned count) { worker_count = count > 0 ? count : 1; }
+    // Avant run() : profondeur de file déclenchant le rejet des basses priorités
+    void set_shed_depth(unsigned depth) { shed_depth = depth; }
+    // Avant run() : trace les étapes de chaque requête, écrites dans `path` à l'arrêt
+    void set_trace_file(const std::string& path) { trace_path = path; }
     void run();
     void stop();
 };
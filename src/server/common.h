@@ -4,7 +4,6 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <semaphore.h>
 #include <string>
 #include <functional>
 #include <unordered_map>
@@ -12,44 +11,172 @@
 #include <cstdint>
 #include <cstdio>
 #include <unistd.h>
-#include "../m_cache/picosha2.h"
+#include <sched.h>
+#include <signal.h>
+#include <cerrno>
+#include <atomic>
+#include "../m_cache/m_v8_shared_cache.h"
+#include "ipc_event.h"
 
-// Taille maximale pour un message
+// Taille maximale pour un message (requête ou réponse, par slot)
 #define MAX_MESSAGE_SIZE 4096*5
 #define SHARED_MEM_NAME "/ipc_router_shared"
+#define IPC_RING_SLOTS 64          // Requêtes en vol, tous clients confondus (puissance de 2, 64 au plus)
+#define IPC_MAX_CLIENTS 64         // Boîtes de réponse, une par client connecté
+#define IPC_SHED_DEPTH 32          // Requêtes en attente au-delà desquelles les basses priorités sont rejetées
 
-// Structure de données partagée
+// Priorité d'une requête : en surcharge, les basses priorités sont rejetées
+#define IPC_PRIORITY_LOW 0         // Facultative (préchargement) : le moteur peut s'en passer
+#define IPC_PRIORITY_NORMAL 1
+#define IPC_PRIORITY_HIGH 2
+
+// Options d'un slot, posées par le client
+#define IPC_SLOT_EXPECTS_RESPONSE 0x1 // Le client lira la réponse puis rendra le slot
+#define IPC_SLOT_EXTERNAL_PAYLOAD 0x2 // Charge utile dans un segment dédié (IPCExternalBuffer)
+
+// Options de la réponse, posées par le serveur
+#define IPC_RESPONSE_EXTERNAL 0x1  // Réponse entière dans un segment dédié
+#define IPC_RESPONSE_EXPIRED 0x2   // Échéance passée avant le traitement : réponse vide
+#define IPC_RESPONSE_OVERLOADED 0x4 // Rejetée par surcharge : réponse vide
+
+// État de la réponse d'un slot
+#define IPC_SLOT_PENDING 0         // Requête publiée ou en cours de traitement
+#define IPC_SLOT_COMPLETED 1       // Réponse écrite, pas encore lue
+#define IPC_SLOT_CONSUMED 2        // Réponse lue (ou abandonnée), slot rendu au pool
+#define IPC_SLOT_CANCELLED 3       // Abandonnée par le client avant la réponse : le serveur rend le slot
+
+#define IPC_EXTERNAL_NAME_SIZE 64
+
+// Segment POSIX portant une charge utile trop grande pour un slot. Le
+// récepteur le mappe puis en retire le nom : seul son mapping le garde en vie.
+struct IPCExternalBuffer
+{
+    char name[IPC_EXTERNAL_NAME_SIZE];
+    uint64_t size;
+};
+
+// Slot du pool : une requête et sa réponse. Le slot n'est rendu au pool
+// qu'une fois la réponse lue par le client, ou dès le traitement si aucune
+// réponse n'est attendue. Un slot gardé n'empêche pas les autres de servir.
+struct IPCSlot
+{
+    alignas(64) uint32_t flags;    // IPC_SLOT_*
+    uint32_t message_size;         // Taille réelle du message
+    uint32_t client_id;            // Boîte de réponse du client
+    uint32_t client_generation;    // Génération de la boîte à l'envoi
+    uint64_t published_ns;         // ipc_now_ns de la publication si le client trace, sinon 0
+    // Boîte et génération du client entre la prise du slot et sa publication
+    // (ipc_slot_reservation), 0 sinon : un slot pris par un client mort avant
+    // publication est rendu au pool par le repreneur de sa boîte
+    std::atomic<uint64_t> reserved_by;
+    IPCExternalBuffer external;    // Si IPC_SLOT_EXTERNAL_PAYLOAD
+
+    alignas(64) std::atomic<uint32_t> state; // IPC_SLOT_PENDING / COMPLETED / CONSUMED / CANCELLED
+    uint32_t response_message_id;
+    uint32_t response_size;
+    uint32_t response_flags;       // IPC_RESPONSE_*
+    IPCExternalBuffer response_external; // Si IPC_RESPONSE_EXTERNAL
+
+    alignas(64) char message[MAX_MESSAGE_SIZE];
+    alignas(64) char response[MAX_MESSAGE_SIZE];
+};
+
+// Boîte de réponse d'un client : le serveur la signale à chaque réponse qui
+// lui est destinée, le client vérifie ensuite ses propres slots
+struct IPCMailbox
+{
+    alignas(64) std::atomic<int32_t> owner_pid; // 0 = libre
+    std::atomic<uint32_t> generation; // Incrémentée à chaque prise ou libération
+    IPCEvent ready;
+};
+
+// Case de l'anneau : le numéro d'un slot publié
+struct IPCRingCell
+{
+    std::atomic<uint64_t> sequence; // Protocole de l'anneau MPMC (Vyukov)
+    uint32_t slot_index;
+};
+
+// Structure de données partagée : pool de slots et anneau multi-producteurs /
+// multi-consommateurs des slots publiés. L'anneau a autant de cases que le
+// pool a de slots, il ne peut donc jamais être plein.
 struct SharedData
 {
-    sem_t mutex;           // Sémaphore pour l'accès exclusif
-    sem_t data_ready;      // Sémaphore pour signaler qu'un message est prêt
-    sem_t response_ready;  // Sémaphore pour signaler qu'une réponse est prête
+    alignas(64) std::atomic<uint64_t> enqueue_pos; // Prochaine position réservée par un client
+    alignas(64) std::atomic<uint64_t> dequeue_pos; // Prochaine position prise par le serveur
+    alignas(64) std::atomic<uint64_t> busy_slots;  // Bit i : slot i pris par un client
+    alignas(64) IPCEvent data_ready; // Signalé à chaque requête publiée
+    alignas(64) std::atomic<uint32_t> next_message_id; // Identifiants uniques entre clients
+    char cache_path[256];          // Fichier de cache du serveur, pour les lectures par référence
 
-    // Buffer pour les messages
-    char message[MAX_MESSAGE_SIZE];
-    // Métadonnées du message actuel
-    bool has_message;      // Indique si un message est présent
-    size_t message_size;   // Taille réelle du message
+    IPCRingCell ring[IPC_RING_SLOTS];
+    IPCMailbox mailboxes[IPC_MAX_CLIENTS];
+    IPCSlot slots[IPC_RING_SLOTS];
+};
 
-    // Buffer pour les réponses (optionnel)
-    char response[MAX_MESSAGE_SIZE];
-    size_t response_size;
-    bool has_response;
+static_assert((IPC_RING_SLOTS & (IPC_RING_SLOTS - 1)) == 0, "IPC_RING_SLOTS doit être une puissance de 2");
+static_assert(IPC_RING_SLOTS <= 64, "Le pool de slots tient dans un mot de 64 bits");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "L'anneau partagé exige des atomiques sans verrou");
 
-     // ID de message pour associer requête/réponse
-    uint32_t current_message_id;
-    uint32_t response_message_id;
+// Routes connues du serveur. L'identifiant d'une route est son indice dans
+// cette table : client et serveur le calculent à la compilation (IPC_ROUTE),
+// le serveur l'utilise directement comme indice de sa table de dispatch.
+// Ajouter les nouvelles routes à la fin : l'ordre fait partie du protocole.
+constexpr const char* IPC_ROUTE_NAMES[] = {
+    "user/create",
+    "user/get",
+    "user/delete",
+    "function/add_ir_graph",
+    "function/get_ir",
+    "function/get_ir_graph",
+    "bytecode/save",
+    "bytecode/get",
+    "bytecode/get_ref",
+    "function/get_ir_graph_ref",
+    "bytecode/get_many",
+    "function/get_ir_graph_many",
+    "bytecode/save_many",
+    "function/add_ir_graph_many",
+    "stats/get",
 };
 
+constexpr uint32_t IPC_ROUTE_COUNT = sizeof(IPC_ROUTE_NAMES) / sizeof(IPC_ROUTE_NAMES[0]);
+
+// Indice de la route `name`, IPC_ROUTE_COUNT si elle est inconnue
+constexpr uint32_t ipc_route_id(const char* name)
+{
+    for (uint32_t id = 0; id < IPC_ROUTE_COUNT; ++id) {
+        const char* known = IPC_ROUTE_NAMES[id];
+        uint32_t i = 0;
+        while (known[i] != '\0' && known[i] == name[i]) ++i;
+        if (known[i] == name[i]) return id;
+    }
+    return IPC_ROUTE_COUNT;
+}
+
+template<uint32_t Id>
+constexpr uint32_t ipc_checked_route()
+{
+    static_assert(Id < IPC_ROUTE_COUNT, "Route inconnue : l'ajouter à IPC_ROUTE_NAMES");
+    return Id;
+}
+
+// Identifiant d'une route, résolu et vérifié à la compilation
+#define IPC_ROUTE(name) ipc_checked_route<ipc_route_id(name)>()
+
 // Structure de base pour tous les messages
 struct IPCMessage
 {
     uint32_t message_id;     // ID unique du type de message
-    char route_hash[256];     // Hash de la route
+    uint32_t route_id;       // Indice dans IPC_ROUTE_NAMES
+    uint32_t priority;       // IPC_PRIORITY_*
     uint32_t payload_size;   // Taille des données utiles
+    uint64_t deadline_ns;    // Échéance (ipc_now_ns) au-delà de laquelle la réponse est inutile, 0 = aucune
     char payload[];          // Données variables
 };
 
+static_assert(sizeof(IPCMessage) == 24, "En-tête de message compact");
+
 // Exemples de structures de requêtes
 struct CreateUserRequest
 {
@@ -109,6 +236,96 @@ struct GetBytecodeResponse {
     uint8_t bytecode[];             // Bytecode sérialisé (Flexible Array Member)
 };
 
+// Lecture par référence (routes bytecode/get_ref et function/get_ir_graph_ref) :
+// la réponse donne l'emplacement de l'entrée dans le fichier de cache, que le
+// client lit sur place avec un m_cache::SharedCacheReader
+struct GetCacheRefRequest {
+    char function_code_hash[256];
+};
+
+struct GetCacheRefResponse {
+    bool success;
+    m_cache::CacheRef ref;
+    char error_message[128];
+};
+
+// Lots (routes bytecode/get_many, function/get_ir_graph_many,
+// bytecode/save_many, function/add_ir_graph_many) : servis par le cache en
+// une seule prise de verrou, avec un statut par clé
+#define IPC_BATCH_FOUND 0          // Données présentes / écrites
+#define IPC_BATCH_NOT_FOUND 1      // Clé absente du cache
+#define IPC_BATCH_FAILED 2         // Écriture refusée (budget, cache plein) ou entrée invalide
+
+// Requête de lecture : count hashes à la suite, chacun terminé par '\0'
+struct GetManyRequest {
+    uint32_t count;
+    char function_code_hashes[];
+};
+
+// Descripteur d'une clé dans la réponse de lecture
+struct GetManyEntry {
+    uint32_t status;                 // IPC_BATCH_*
+    uint32_t size;                   // Taille des données
+    uint64_t offset;                 // Depuis le début de la réponse
+};
+
+// Réponse de lecture : en-tête, count descripteurs dans l'ordre de la
+// requête, puis les données des clés trouvées
+struct GetManyResponse {
+    uint32_t count;
+    uint32_t found;
+    GetManyEntry entries[];
+};
+
+// Descripteur d'une écriture ; data_offset compte depuis la fin du tableau
+struct PutManyEntry {
+    char function_code_hash[256];
+    uint32_t size;
+    uint64_t data_offset;
+};
+
+// Requête d'écriture : en-tête, count descripteurs, puis les données
+struct PutManyRequest {
+    uint32_t count;
+    PutManyEntry entries[];
+};
+
+// Réponse d'écriture : un statut IPC_BATCH_* par descripteur
+struct PutManyResponse {
+    uint32_t count;
+    uint32_t stored;
+    uint8_t status[];
+};
+
+// Route stats/get : résumé des métriques du serveur. Les histogrammes
+// complets sont publiés dans le segment IPC_STATS_NAME (stats.h).
+struct RouteStatsSummary {
+    uint64_t count;                  // Requêtes traitées
+    uint64_t expired;                // Rejetées, échéance dépassée
+    uint64_t overloaded;             // Rejetées, surcharge
+    uint64_t mean_ns;                // Temps de traitement
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+struct CacheStatsSummary {
+    m_cache::CacheStats activity;    // Compteurs du cache dans le serveur
+    uint64_t used_bytes;
+    uint64_t file_size;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct GetStatsResponse {
+    uint32_t route_count;            // IPC_ROUTE_COUNT du serveur
+    uint32_t reserved;
+    CacheStatsSummary cache;
+    RouteStatsSummary routes[IPC_ROUTE_COUNT]; // Indexées comme IPC_ROUTE_NAMES
+};
+
 struct GetFunctionIRRequest
 {
     char function_code_hash[256];
@@ -133,16 +350,306 @@ struct DeleteUserRequest
     uint32_t user_id;
 };
 
-// Fonctions utilitaires
-inline std::string hash_route(const std::string& route)
+// Nomme le segment d'une charge utile ; les identifiants de message étant
+// uniques, le nom l'est aussi
+inline void ipc_external_init(IPCExternalBuffer* buffer, const char* direction, uint32_t message_id,
+    uint64_t size)
+{
+    snprintf(buffer->name, sizeof(buffer->name), "%s_%s_%u", SHARED_MEM_NAME, direction, message_id);
+    buffer->size = size;
+}
+
+// Crée le segment et le mappe en écriture ; nullptr en cas d'échec
+inline void* ipc_external_create(const IPCExternalBuffer& buffer)
+{
+    int fd = shm_open(buffer.name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    if (fd == -1 && errno == EEXIST) {
+        // Reste d'une exécution précédente du serveur (identifiants repartis de 1)
+        shm_unlink(buffer.name);
+        fd = shm_open(buffer.name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    }
+    if (fd == -1) {
+        perror("shm_open segment");
+        return nullptr;
+    }
+    if (ftruncate(fd, buffer.size) == -1) {
+        perror("ftruncate segment");
+        close(fd);
+        shm_unlink(buffer.name);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, buffer.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap segment");
+        shm_unlink(buffer.name);
+        return nullptr;
+    }
+    return data;
+}
+
+// Mappe en lecture un segment reçu et en retire le nom ; nullptr en cas d'échec
+inline void* ipc_external_open(const IPCExternalBuffer& buffer)
+{
+    int fd = shm_open(buffer.name, O_RDONLY, 0);
+    if (fd == -1) {
+        perror("shm_open segment");
+        return nullptr;
+    }
+    shm_unlink(buffer.name);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<uint64_t>(st.st_size) < buffer.size) {
+        fprintf(stderr, "Segment %s tronqué\n", buffer.name);
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, buffer.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap segment");
+        return nullptr;
+    }
+    return data;
+}
+
+// Identifiant de corrélation unique pour tous les clients du segment
+inline uint32_t generate_message_id(SharedData* data)
+{
+    uint32_t id = data->next_message_id.fetch_add(1, std::memory_order_relaxed);
+    return id != 0 ? id : data->next_message_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint32_t ipc_slot_index(const SharedData* data, const IPCSlot& slot)
+{
+    return static_cast<uint32_t>(&slot - data->slots);
+}
+
+inline uint64_t ipc_slot_reservation(uint32_t client_id, uint32_t generation)
+{
+    return (static_cast<uint64_t>(client_id) + 1) << 32 | generation;
+}
+
+// Prend un slot libre du pool au nom d'une boîte (attend si tous sont pris) ;
+// false si l'échéance (0 : aucune) passe avant qu'un slot se libère
+inline bool ipc_slot_acquire(SharedData* data, uint32_t client_id, uint32_t generation,
+    uint64_t deadline_ns, uint32_t* out_index)
+{
+    uint64_t busy = data->busy_slots.load(std::memory_order_relaxed);
+    for (;;) {
+        if (busy == ~0ULL) {
+            if (deadline_ns != 0 && ipc_now_ns() >= deadline_ns) {
+                return false;
+            }
+            sched_yield();
+            busy = data->busy_slots.load(std::memory_order_relaxed);
+            continue;
+        }
+        uint32_t index = __builtin_ctzll(~busy);
+        if (data->busy_slots.compare_exchange_weak(busy, busy | (1ULL << index),
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            data->slots[index].reserved_by.store(ipc_slot_reservation(client_id, generation),
+                std::memory_order_release);
+            *out_index = index;
+            return true;
+        }
+    }
+}
+
+inline void ipc_slot_free(SharedData* data, uint32_t index)
+{
+    data->busy_slots.fetch_and(~(1ULL << index), std::memory_order_release);
+}
+
+// Rend la requête du slot visible au serveur
+inline void ipc_ring_publish(SharedData* data, uint32_t index)
+{
+    // Publié : le slot suit désormais le cycle PENDING -> COMPLETED -> CONSUMED
+    data->slots[index].reserved_by.store(0, std::memory_order_release);
+
+    uint64_t pos = data->enqueue_pos.load(std::memory_order_relaxed);
+    IPCRingCell* cell;
+    for (;;) {
+        cell = &data->ring[pos & (IPC_RING_SLOTS - 1)];
+        int64_t diff = static_cast<int64_t>(cell->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (data->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else {
+            // Case en cours de lecture par un worker : attente de quelques instructions
+            if (diff < 0) sched_yield();
+            pos = data->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->slot_index = index;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    // Un worker réveillé par requête : chacun vide l'anneau avant de dormir
+    ipc_event_signal(&data->data_ready, 1);
+}
+
+// Prend la plus ancienne requête publiée ; false si aucune n'est prête
+inline bool ipc_ring_take(SharedData* data, uint32_t* out_index)
+{
+    uint64_t pos = data->dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        IPCRingCell& cell = data->ring[pos & (IPC_RING_SLOTS - 1)];
+        int64_t diff = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            if (data->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *out_index = cell.slot_index;
+                cell.sequence.store(pos + IPC_RING_SLOTS, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+        else {
+            pos = data->dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Rend au pool un slot dont la réponse ne sera plus lue
+inline void ipc_slot_reclaim(SharedData* data, IPCSlot& slot)
+{
+    // Segment jamais ouvert si le client est parti (sans effet s'il l'a déjà retiré)
+    if (slot.response_flags & IPC_RESPONSE_EXTERNAL) {
+        shm_unlink(slot.response_external.name);
+    }
+    ipc_slot_free(data, ipc_slot_index(data, slot));
+}
+
+// Consomme une réponse écrite et rend son slot ; un seul des candidats
+// (client, serveur, repreneur de la boîte) y parvient
+inline bool ipc_slot_consume(SharedData* data, IPCSlot& slot)
+{
+    uint32_t expected = IPC_SLOT_COMPLETED;
+    if (!slot.state.compare_exchange_strong(expected, IPC_SLOT_CONSUMED, std::memory_order_acq_rel)) {
+        return false;
+    }
+    ipc_slot_reclaim(data, slot);
+    return true;
+}
+
+// Côté client : renonce à une réponse pas encore écrite, le slot sera rendu
+// par le serveur à la fin du traitement. false si la réponse est déjà là.
+inline bool ipc_slot_cancel(IPCSlot& slot)
+{
+    uint32_t expected = IPC_SLOT_PENDING;
+    return slot.state.compare_exchange_strong(expected, IPC_SLOT_CANCELLED, std::memory_order_acq_rel);
+}
+
+// Renonce à une réponse, écrite ou non
+inline void ipc_slot_abandon(SharedData* data, IPCSlot& slot)
+{
+    if (!ipc_slot_cancel(slot)) {
+        ipc_slot_consume(data, slot);
+    }
+}
+
+// Motif du rejet d'une requête par le serveur, nullptr si elle a été traitée
+inline const char* ipc_response_rejection(const IPCSlot& slot)
+{
+    if (slot.response_flags & IPC_RESPONSE_EXPIRED) return "Échéance dépassée avant le traitement";
+    if (slot.response_flags & IPC_RESPONSE_OVERLOADED) return "Requête rejetée par surcharge du serveur";
+    return nullptr;
+}
+
+// Côté serveur : publie la réponse ; false si le client y a renoncé, le
+// slot étant alors rendu au pool
+inline bool ipc_slot_complete(SharedData* data, IPCSlot& slot)
+{
+    uint32_t expected = IPC_SLOT_PENDING;
+    if (slot.state.compare_exchange_strong(expected, IPC_SLOT_COMPLETED, std::memory_order_acq_rel)) {
+        return true;
+    }
+    ipc_slot_reclaim(data, slot);
+    return false;
+}
+
+// Requêtes réservées ou publiées que les workers n'ont pas encore prises
+inline uint64_t ipc_queue_depth(const SharedData* data)
+{
+    uint64_t enqueued = data->enqueue_pos.load(std::memory_order_relaxed);
+    uint64_t dequeued = data->dequeue_pos.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+inline bool ipc_process_alive(int32_t pid)
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Rend au pool les slots d'une boîte reprise : réponses non lues et slots
+// pris mais jamais publiés par l'ancien propriétaire
+inline void ipc_mailbox_reclaim_slots(SharedData* data, uint32_t client_id, uint32_t generation)
+{
+    for (IPCSlot& slot : data->slots) {
+        uint64_t reservation = slot.reserved_by.load(std::memory_order_acquire);
+        if (reservation >> 32 == static_cast<uint64_t>(client_id) + 1 &&
+            static_cast<uint32_t>(reservation) != generation) {
+            // Un slot libre a toujours reserved_by à 0 : celui-ci est encore
+            // celui de l'ancien propriétaire
+            if (slot.reserved_by.compare_exchange_strong(reservation, 0, std::memory_order_acq_rel)) {
+                if (slot.flags & IPC_SLOT_EXTERNAL_PAYLOAD) {
+                    shm_unlink(slot.external.name);
+                }
+                ipc_slot_free(data, ipc_slot_index(data, slot));
+            }
+            continue;
+        }
+        if (slot.client_id == client_id && slot.client_generation != generation) {
+            ipc_slot_consume(data, slot);
+        }
+    }
+}
+
+// Prend une boîte libre ou abandonnée par un processus mort ; -1 si aucune.
+// Toutes les boîtes de processus morts sont reprises au passage et leurs
+// slots rendus au pool, pas seulement celle qui est retenue.
+inline int ipc_mailbox_claim(SharedData* data, uint32_t* generation)
+{
+    const int32_t self = getpid();
+    int claimed = -1;
+    for (int i = 0; i < IPC_MAX_CLIENTS; ++i) {
+        IPCMailbox& mailbox = data->mailboxes[i];
+        int32_t owner = mailbox.owner_pid.load(std::memory_order_acquire);
+        if (owner != 0 && ipc_process_alive(owner)) continue;
+        if (claimed != -1 && owner == 0) continue;
+        if (!mailbox.owner_pid.compare_exchange_strong(owner, self, std::memory_order_acq_rel)) continue;
+
+        uint32_t current = mailbox.generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+        ipc_mailbox_reclaim_slots(data, static_cast<uint32_t>(i), current);
+        if (claimed == -1) {
+            claimed = i;
+            *generation = current;
+        }
+        else {
+            mailbox.generation.fetch_add(1, std::memory_order_acq_rel);
+            mailbox.owner_pid.store(0, std::memory_order_release);
+        }
+    }
+    return claimed;
+}
+
+inline void ipc_mailbox_release(SharedData* data, int index)
 {
-    return picosha2::hash256_hex_string(route);
+    IPCMailbox& mailbox = data->mailboxes[index];
+    mailbox.generation.fetch_add(1, std::memory_order_acq_rel);
+    mailbox.owner_pid.store(0, std::memory_order_release);
 }
 
-inline uint32_t generate_message_id()
+// Le client qui a envoyé une requête est-il toujours là ? Prend les valeurs
+// relevées dans le slot avant de le compléter : le slot peut être repris ensuite
+inline bool ipc_mailbox_current(SharedData* data, uint32_t client_id, uint32_t generation)
 {
-    static uint32_t counter = 0;
-    return ++counter;
+    return client_id < IPC_MAX_CLIENTS &&
+        data->mailboxes[client_id].generation.load(std::memory_order_acquire) == generation;
 }
 
 #endif // IPC_COMMON_H
@@ -0,0 +1,93 @@
+#ifndef IPC_EVENT_H
+#define IPC_EVENT_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <unistd.h>
+#include <ctime>
+#include "../m_cache/m_shared_lock.h"
+
+// Attente adaptative : d'abord quelques tours actifs sur le mot de séquence,
+// puis sommeil sur un futex. Le signal ne fait d'appel système que si
+// quelqu'un dort réellement.
+#define IPC_SPIN_MIN 64
+#define IPC_SPIN_MAX 8192
+
+// Événement partagé entre processus, placé dans SharedData
+struct IPCEvent
+{
+    std::atomic<uint32_t> sequence; // Incrémentée à chaque signal
+    std::atomic<uint32_t> sleepers; // Attentes en cours sur le futex
+};
+
+// Durée de spin propre à chaque attente : elle double quand le spin suffit,
+// diminue de moitié quand il a fallu dormir. Nulle sur une machine à un seul
+// cœur, où tourner empêche justement l'autre côté de répondre.
+struct IPCSpinBudget
+{
+    uint32_t iterations = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? IPC_SPIN_MIN * 4 : 0;
+};
+
+// Horloge des échéances : CLOCK_MONOTONIC est commune à tous les processus
+inline uint64_t ipc_now_ns()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+inline void ipc_cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// waiters : dormeurs à réveiller. Un seul suffit quand chacun vide toute la
+// file avant de se rendormir (requêtes vers les workers du serveur).
+inline void ipc_event_signal(IPCEvent* event, int waiters = INT_MAX)
+{
+    event->sequence.fetch_add(1, std::memory_order_seq_cst);
+    if (event->sleepers.load(std::memory_order_seq_cst) != 0) {
+        m_cache::FutexWake(&event->sequence, waiters);
+    }
+}
+
+// À lire avant de tester la condition attendue, puis à passer à ipc_event_wait
+inline uint32_t ipc_event_prepare(const IPCEvent* event)
+{
+    return event->sequence.load(std::memory_order_acquire);
+}
+
+// Retourne dès qu'un signal a suivi `seen`, à l'échéance deadline_ns
+// (ipc_now_ns, 0 = aucune) ou sur interruption : l'appelant reteste sa
+// condition et l'heure dans tous les cas
+inline void ipc_event_wait(IPCEvent* event, uint32_t seen, IPCSpinBudget* budget,
+    uint64_t deadline_ns = 0)
+{
+    for (uint32_t i = 0; i < budget->iterations; ++i) {
+        if (event->sequence.load(std::memory_order_acquire) != seen) {
+            if (budget->iterations < IPC_SPIN_MAX) budget->iterations *= 2;
+            return;
+        }
+        ipc_cpu_relax();
+    }
+    if (budget->iterations > IPC_SPIN_MIN) budget->iterations /= 2;
+
+    timespec timeout;
+    if (deadline_ns != 0) {
+        uint64_t now = ipc_now_ns();
+        if (now >= deadline_ns) return;
+        timeout.tv_sec = (deadline_ns - now) / 1000000000ULL;
+        timeout.tv_nsec = (deadline_ns - now) % 1000000000ULL;
+    }
+
+    event->sleepers.fetch_add(1, std::memory_order_seq_cst);
+    m_cache::FutexWait(&event->sequence, seen, deadline_ns != 0 ? &timeout : nullptr);
+    event->sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+#endif // IPC_EVENT_H
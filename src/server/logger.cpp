@@ -0,0 +1,208 @@
+#include "logger.h"
+#include "ipc_event.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define LOG_FLUSH_INTERVAL_NS 20000000ULL // Écriture au plus tard toutes les 20 ms
+#define LOG_OUTPUT_BUFFER 16384
+
+static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0, "LOG_RING_RECORDS doit être une puissance de 2");
+
+std::atomic<uint8_t> Logger::min_level{LOG_LEVEL_INFO};
+
+namespace {
+
+    // Même protocole que l'anneau IPC : la séquence d'une case indique si
+    // elle attend un producteur (pos) ou le thread d'écriture (pos + 1)
+    struct alignas(64) LogRecord
+    {
+        std::atomic<uint64_t> sequence;
+        uint64_t time_ns;              // CLOCK_REALTIME, lue sans appel système (vDSO)
+        uint8_t level;
+        uint16_t length;
+        char text[LOG_RECORD_TEXT];
+    };
+
+    LogRecord ring[LOG_RING_RECORDS];
+    alignas(64) std::atomic<uint64_t> enqueue_pos{0};
+    alignas(64) std::atomic<uint64_t> dequeue_pos{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopping{false};
+    IPCEvent ready;
+    std::thread drain_thread;
+
+    const char* const level_names[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+    uint64_t realtime_ns()
+    {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+    }
+
+    // Tampon de sortie d'un flux, vidé en un seul write()
+    struct OutputBuffer
+    {
+        int fd;
+        size_t used = 0;
+        char data[LOG_OUTPUT_BUFFER];
+
+        explicit OutputBuffer(int descriptor) : fd(descriptor) {}
+
+        void flush()
+        {
+            size_t done = 0;
+            while (done < used) {
+                ssize_t n = ::write(fd, data + done, used - done);
+                if (n <= 0) break;
+                done += n;
+            }
+            used = 0;
+        }
+
+        void append(uint64_t time_ns, uint8_t level, const char* text, size_t length)
+        {
+            if (used + length + 32 > sizeof(data)) {
+                flush();
+            }
+            time_t seconds = time_ns / 1000000000ULL;
+            tm local;
+            localtime_r(&seconds, &local);
+            used += snprintf(data + used, sizeof(data) - used, "%02d:%02d:%02d.%03u %s ",
+                local.tm_hour, local.tm_min, local.tm_sec,
+                static_cast<unsigned>(time_ns % 1000000000ULL / 1000000), level_names[level]);
+            memcpy(data + used, text, length);
+            used += length;
+            data[used++] = '\n';
+        }
+    };
+
+    OutputBuffer out(STDOUT_FILENO);
+    OutputBuffer err(STDERR_FILENO);
+
+    // Vide l'anneau ; avertissements et erreurs vont sur stderr
+    void drain()
+    {
+        uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            LogRecord& record = ring[pos & (LOG_RING_RECORDS - 1)];
+            if (record.sequence.load(std::memory_order_acquire) != pos + 1) break;
+            OutputBuffer& target = record.level >= LOG_LEVEL_WARN ? err : out;
+            target.append(record.time_ns, record.level, record.text, record.length);
+            record.sequence.store(pos + LOG_RING_RECORDS, std::memory_order_release);
+            dequeue_pos.store(++pos, std::memory_order_relaxed);
+        }
+
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            char text[64];
+            int length = snprintf(text, sizeof(text), "%" PRIu64 " message(s) perdu(s), journal saturé", lost);
+            err.append(realtime_ns(), LOG_LEVEL_WARN, text, length);
+        }
+        out.flush();
+        err.flush();
+    }
+
+    void drain_loop()
+    {
+        IPCSpinBudget budget;
+        budget.iterations = 0; // Rien ne presse : dormir directement
+        while (!stopping.load(std::memory_order_acquire)) {
+            uint32_t seen = ipc_event_prepare(&ready);
+            drain();
+            ipc_event_wait(&ready, seen, &budget, ipc_now_ns() + LOG_FLUSH_INTERVAL_NS);
+        }
+        drain();
+    }
+
+} // namespace
+
+void Logger::start()
+{
+    if (running.load()) return;
+    // Chaque case attend d'abord la position égale à son indice
+    if (enqueue_pos.load() == 0) {
+        for (uint64_t i = 0; i < LOG_RING_RECORDS; ++i) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    drain_thread = std::thread(drain_loop);
+}
+
+void Logger::stop()
+{
+    if (!running.load()) return;
+    stopping.store(true, std::memory_order_release);
+    ipc_event_signal(&ready);
+    drain_thread.join();
+    running.store(false);
+}
+
+bool Logger::parse_level(const char* name, LogLevel* level)
+{
+    static const char* const names[] = { "debug", "info", "warn", "error" };
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            *level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::write(LogLevel level, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    // Pas encore de thread d'écriture (démarrage, arrêt) : écriture directe
+    if (!running.load(std::memory_order_acquire)) {
+        FILE* stream = level >= LOG_LEVEL_WARN ? stderr : stdout;
+        vfprintf(stream, format, args);
+        fputc('\n', stream);
+        va_end(args);
+        return;
+    }
+
+    // Réserver une case ; anneau plein : le message est perdu, jamais attendu
+    uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    LogRecord* record;
+    for (;;) {
+        record = &ring[pos & (LOG_RING_RECORDS - 1)];
+        int64_t diff = static_cast<int64_t>(record->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            va_end(args);
+            return;
+        }
+        else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->time_ns = realtime_ns();
+    record->level = level;
+    int length = vsnprintf(record->text, sizeof(record->text), format, args);
+    va_end(args);
+    record->length = static_cast<uint16_t>(std::clamp<int>(length, 0, sizeof(record->text) - 1));
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    // Réveil anticipé pour les erreurs et quand l'anneau se remplit ; sinon
+    // le thread d'écriture passe de lui-même
+    if (level >= LOG_LEVEL_ERROR ||
+        pos - dequeue_pos.load(std::memory_order_relaxed) >= LOG_RING_RECORDS / 2) {
+        ipc_event_signal(&ready);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Niveaux de journalisation, du plus bavard au plus grave
+enum LogLevel : uint8_t
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3,
+};
+
+// Niveau minimal compilé : en release (NDEBUG) les traces de debug
+// disparaissent, arguments compris
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOG_RING_RECORDS 4096      // Puissance de 2
+#define LOG_RECORD_TEXT 232        // Au-delà, le message est tronqué
+
+// Journal du serveur : l'appelant formate son message dans un anneau
+// multi-producteurs sans verrou, un thread dédié l'écrit par lots. Aucun
+// appel système sur le chemin des requêtes ; si l'anneau est plein, le
+// message est compté comme perdu plutôt que d'attendre.
+class Logger
+{
+public:
+    // Démarre le thread d'écriture ; avant, les messages sont écrits directement
+    static void start();
+    // Écrit ce qui reste dans l'anneau puis arrête le thread
+    static void stop();
+
+    static void set_level(LogLevel level) { min_level.store(level, std::memory_order_relaxed); }
+    static bool enabled(LogLevel level) { return level >= min_level.load(std::memory_order_relaxed); }
+    // "debug", "info", "warn" ou "error" ; false si le nom est inconnu
+    static bool parse_level(const char* name, LogLevel* level);
+
+    static void write(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    static std::atomic<uint8_t> min_level;
+};
+
+// Le test compile-time retire l'appel et l'évaluation des arguments ; le
+// test à l'exécution ne coûte qu'une lecture relâchée
+#define LOG_AT(level, ...)                                              \
+    do {                                                                \
+        if constexpr ((level) >= LOG_COMPILED_LEVEL) {                  \
+            if (Logger::enabled(level)) Logger::write(level, __VA_ARGS__); \
+        }                                                               \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOGGER_H
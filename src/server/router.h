@@ -2,49 +2,53 @@
 #define IPC_ROUTER_H
 
 #include "common.h"
+#include "logger.h"
+#include <array>
 
 class IPCRouter
 {
 private:
-    std::unordered_map<std::string, std::function<void(const char*, size_t)>> routes;
+    // Table dense indexée par l'identifiant de route : ni hachage ni allocation au dispatch
+    std::array<std::function<void(const char*, size_t)>, IPC_ROUTE_COUNT> routes;
 
 public:
     // Enregistrer une route avec sa fonction de traitement
     template<typename RequestType>
-    void register_route(const std::string& route,
+    void register_route(uint32_t route_id,
         std::function<void(const RequestType&)> handler)
     {
-        std::string route_hash = hash_route(route);
-
-        routes[route_hash] = [handler](const char* data, size_t size) {
+        routes[route_id] = [handler](const char* data, size_t size) {
             if (size >= sizeof(RequestType)) {
                 const RequestType* request = reinterpret_cast<const RequestType*>(data);
                 handler(*request);
             }
             else {
-                printf("Erreur: taille de données insuffisante pour la route\n");
+                LOG_ERROR("Erreur: taille de données insuffisante pour la route");
             }
             };
 
-        printf("Route enregistrée: %s (hash: %s)\n", route.c_str(), route_hash.c_str());
+        LOG_DEBUG("Route enregistrée: %s (id: %u)", IPC_ROUTE_NAMES[route_id], route_id);
     }
 
     // Nouvelle méthode pour tailles variables
-    void register_variable_route(const std::string& route,
+    void register_variable_route(uint32_t route_id,
         std::function<void(const char*, size_t)> handler)
     {
-        std::string route_hash = hash_route(route);
-        routes[route_hash] = handler;
-        printf("Route variable enregistrée: %s (hash: %s)\n", route.c_str(), route_hash.c_str());
+        routes[route_id] = handler;
+        LOG_DEBUG("Route variable enregistrée: %s (id: %u)", IPC_ROUTE_NAMES[route_id], route_id);
     }
 
     // Traiter un message reçu
     void dispatch_message(const IPCMessage* message)
     {
-        std::string route_hash(message->route_hash);
-        auto it = routes.find(route_hash);
-        if (it != routes.end()) {
-            it->second(message->payload, message->payload_size);
+        dispatch_message(message, message->payload, message->payload_size);
+    }
+
+    // Charge utile hors du message (segment dédié aux gros transferts)
+    void dispatch_message(const IPCMessage* message, const char* payload, size_t payload_size)
+    {
+        if (message->route_id < IPC_ROUTE_COUNT && routes[message->route_id]) {
+            routes[message->route_id](payload, payload_size);
         }
         else {
             handle_unknown_route(message);
@@ -54,7 +58,7 @@ public:
 private:
     void handle_unknown_route(const IPCMessage* message)
     {
-        printf("Route inconnue: hash %s\n", message->route_hash);
+        LOG_WARN("Route inconnue: id %u", message->route_id);
     }
 };
 
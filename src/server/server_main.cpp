@@ -1,5 +1,9 @@
 #include "cache_server.h"
+#include "../m_cache/m_v8_shared_cache.h"
 #include <signal.h>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
 
 IPCServer* server_instance = nullptr;
 
@@ -10,15 +14,111 @@ void signal_handler(int) {
     }
 }
 
-int main() {
+static void print_usage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --cache-path <fichier>     Fichier du cache (défaut: %s)\n", CACHE_FILE_PATH);
+    printf("  --cache-size <Mo>          Taille initiale du fichier (défaut: %d)\n",
+           CACHE_FILE_SIZE / (1024 * 1024));
+    printf("  --cache-max-size <Mo>      Taille maximale atteinte par croissance (défaut: %llu)\n",
+           CACHE_MAX_FILE_SIZE / (1024 * 1024));
+    printf("  --cache-entries <n>        Nombre maximal d'entrées (défaut: %d)\n", CACHE_MAX_ENTRIES);
+    printf("  --bytecode-share <%%>       Part du cache réservée au bytecode, le reste aux graphes IR (défaut: 50)\n");
+    printf("  --busy-poll <cœur>         Attente active épinglée à partir de ce cœur au lieu du sommeil futex\n");
+    printf("  --workers <n>              Threads de traitement des requêtes (défaut: nombre de cœurs, 1 avec --busy-poll)\n");
+    printf("  --trace <fichier>          Trace les étapes de chaque requête, écrite à l'arrêt au format Chrome trace\n");
+    printf("  --log-level <niveau>       debug, info, warn ou error (défaut: info ; debug absent des builds release)\n");
+    printf("  --shed-depth <n>           Requêtes en attente au-delà desquelles les basses priorités sont rejetées (défaut: %d)\n",
+           IPC_SHED_DEPTH);
+}
+
+// Les dimensions ne s'appliquent qu'à la création du fichier de cache
+static bool parse_args(int argc, char* argv[], m_cache::CacheConfig& config, int& busy_poll_cpu,
+                       unsigned& worker_count, unsigned& shed_depth, LogLevel& log_level,
+                       std::string& trace_path) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0 || i + 1 >= argc) {
+            return false;
+        }
+
+        const char* value = argv[++i];
+        char* end = nullptr;
+        unsigned long long number = strtoull(value, &end, 10);
+        bool numeric = *value != '\0' && *end == '\0' && number > 0;
+
+        if (strcmp(arg, "--busy-poll") == 0 && *value != '\0' && *end == '\0' && number < CPU_SETSIZE) {
+            busy_poll_cpu = static_cast<int>(number);
+        } else if (strcmp(arg, "--workers") == 0 && numeric && number <= 1024) {
+            worker_count = static_cast<unsigned>(number);
+        } else if (strcmp(arg, "--shed-depth") == 0 && numeric && number <= IPC_RING_SLOTS) {
+            shed_depth = static_cast<unsigned>(number);
+        } else if (strcmp(arg, "--log-level") == 0 && Logger::parse_level(value, &log_level)) {
+        } else if (strcmp(arg, "--trace") == 0) {
+            trace_path = value;
+        } else if (strcmp(arg, "--cache-path") == 0) {
+            config.path = value;
+        } else if (strcmp(arg, "--cache-size") == 0 && numeric) {
+            config.initial_size = number * 1024 * 1024;
+        } else if (strcmp(arg, "--cache-max-size") == 0 && numeric) {
+            config.max_size = number * 1024 * 1024;
+        } else if (strcmp(arg, "--cache-entries") == 0 && numeric && number <= UINT32_MAX) {
+            config.max_entries = static_cast<uint32_t>(number);
+        } else if (strcmp(arg, "--bytecode-share") == 0 && numeric && number < 100) {
+            uint32_t share = static_cast<uint32_t>(number);
+            config.namespace_share[static_cast<int>(m_cache::CacheNamespace::kBytecode)] = share;
+            config.namespace_share[static_cast<int>(m_cache::CacheNamespace::kIRGraph)] = 100 - share;
+        } else {
+            fprintf(stderr, "Option invalide: %s %s\n", arg, value);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    m_cache::CacheConfig config;
+    int busy_poll_cpu = -1;
+    unsigned worker_count = 0;
+    unsigned shed_depth = IPC_SHED_DEPTH;
+    LogLevel log_level = LOG_LEVEL_INFO;
+    std::string trace_path;
+    if (!parse_args(argc, argv, config, busy_poll_cpu, worker_count, shed_depth, log_level, trace_path)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    // Chaque worker en attente active occupe un cœur : un seul par défaut,
+    // et jamais plus que de cœurs en ligne
+    if (busy_poll_cpu >= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        if (worker_count == 0) {
+            worker_count = 1;
+        }
+        if (online > 0 && (busy_poll_cpu >= online || worker_count > static_cast<unsigned long>(online))) {
+            fprintf(stderr, "Option invalide: --busy-poll %d avec %u worker(s) sur %ld cœur(s)\n",
+                    busy_poll_cpu, worker_count, online);
+            return 1;
+        }
+    }
+    Logger::set_level(log_level);
+    m_cache::SharedCache::Instance().Configure(config);
+
     IPCServer server;
+    server.set_busy_poll(busy_poll_cpu);
+    if (worker_count > 0) {
+        server.set_worker_count(worker_count);
+    }
+    server.set_shed_depth(shed_depth);
+    server.set_trace_file(trace_path);
     server_instance = &server;
 
     // Gérer l'arrêt propre avec Ctrl+C
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
+    // Journal écrit par un thread dédié pendant le service
+    Logger::start();
     server.run();
+    Logger::stop();
 
     return 0;
 }
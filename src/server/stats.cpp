@@ -0,0 +1,150 @@
+#include "stats.h"
+#include "logger.h"
+#include <algorithm>
+
+IPCStats::~IPCStats()
+{
+    stop();
+    if (page) {
+        munmap(page, sizeof(IPCStatsPage));
+        shm_unlink(IPC_STATS_NAME);
+    }
+}
+
+bool IPCStats::initialize()
+{
+    int fd = shm_open(IPC_STATS_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        LOG_ERROR("Erreur: impossible de créer %s: %s", IPC_STATS_NAME, strerror(errno));
+        return false;
+    }
+    // Remise à zéro d'un segment laissé par un serveur précédent
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, sizeof(IPCStatsPage)) == -1) {
+        LOG_ERROR("Erreur: impossible de dimensionner %s: %s", IPC_STATS_NAME, strerror(errno));
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(IPCStatsPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Erreur: impossible de mapper %s: %s", IPC_STATS_NAME, strerror(errno));
+        return false;
+    }
+
+    page = static_cast<IPCStatsPage*>(mapping);
+    page->shard_count = IPC_STATS_SHARDS;
+    page->route_count = IPC_ROUTE_COUNT;
+    page->bucket_count = IPC_STATS_BUCKETS;
+    page->sub_bucket_bits = IPC_STATS_SUB_BITS;
+    for (uint32_t i = 0; i < IPC_ROUTE_COUNT; ++i) {
+        strncpy(page->route_names[i], IPC_ROUTE_NAMES[i], sizeof(page->route_names[i]) - 1);
+    }
+    refresh_cache();
+    page->version = IPC_STATS_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    page->magic = IPC_STATS_MAGIC;
+    return true;
+}
+
+void IPCStats::start()
+{
+    if (!page || refresher.joinable()) return;
+    stopping.store(false, std::memory_order_relaxed);
+    refresher = std::thread(&IPCStats::refresh_loop, this);
+}
+
+void IPCStats::stop()
+{
+    if (!refresher.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    ipc_event_signal(&wake);
+    refresher.join();
+}
+
+// Appelé par le worker propriétaire du shard : pas de contention, les
+// atomiques ne servent qu'aux lecteurs concurrents
+void IPCStats::record(IPCRouteStats& route, uint64_t elapsed_ns)
+{
+    route.count.fetch_add(1, std::memory_order_relaxed);
+    route.total_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    route.buckets[ipc_stats_bucket(elapsed_ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = route.max_ns.load(std::memory_order_relaxed);
+    while (elapsed_ns > max &&
+        !route.max_ns.compare_exchange_weak(max, elapsed_ns, std::memory_order_relaxed)) {
+    }
+}
+
+void IPCStats::summarize(GetStatsResponse* response) const
+{
+    memset(response, 0, sizeof(*response));
+    response->route_count = IPC_ROUTE_COUNT;
+
+    // Compteurs du cache relus directement, plus frais que ceux de la page
+    m_cache::SharedCache& cache = m_cache::SharedCache::Instance();
+    response->cache.activity = cache.GetStats();
+    response->cache.used_bytes = cache.GetUsedSpace();
+    response->cache.file_size = cache.GetFileSize();
+    response->cache.entry_count = cache.GetEntryCount();
+    if (!page) return;
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    std::vector<uint64_t> buckets(IPC_STATS_BUCKETS);
+    for (uint32_t r = 0; r < IPC_ROUTE_COUNT; ++r) {
+        RouteStatsSummary& summary = response->routes[r];
+        uint64_t total_ns = 0;
+        std::fill(buckets.begin(), buckets.end(), 0);
+        for (const IPCStatsShard& shard : page->shards) {
+            const IPCRouteStats& route = shard.routes[r];
+            summary.count += route.count.load(std::memory_order_relaxed);
+            summary.expired += route.expired.load(std::memory_order_relaxed);
+            summary.overloaded += route.overloaded.load(std::memory_order_relaxed);
+            summary.max_ns = std::max(summary.max_ns, route.max_ns.load(std::memory_order_relaxed));
+            total_ns += route.total_ns.load(std::memory_order_relaxed);
+            for (uint32_t b = 0; b < IPC_STATS_BUCKETS; ++b) {
+                buckets[b] += route.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+        if (summary.count == 0) continue;
+        summary.mean_ns = total_ns / summary.count;
+
+        // Borne haute du bucket qui atteint chaque quantile, sans dépasser le max
+        uint64_t* targets[] = { &summary.p50_ns, &summary.p90_ns, &summary.p99_ns, &summary.p999_ns };
+        uint64_t seen = 0;
+        uint32_t q = 0;
+        for (uint32_t b = 0; b < IPC_STATS_BUCKETS && q < 4; ++b) {
+            seen += buckets[b];
+            while (q < 4 && seen > 0 && seen >= quantiles[q] * summary.count) {
+                *targets[q++] = std::min(ipc_stats_bucket_max(b), summary.max_ns);
+            }
+        }
+    }
+}
+
+void IPCStats::refresh_cache()
+{
+    CacheStatsSummary cache;
+    memset(&cache, 0, sizeof(cache));
+    m_cache::SharedCache& shared_cache = m_cache::SharedCache::Instance();
+    cache.activity = shared_cache.GetStats();
+    cache.used_bytes = shared_cache.GetUsedSpace();
+    cache.file_size = shared_cache.GetFileSize();
+    cache.entry_count = shared_cache.GetEntryCount();
+
+    uint32_t sequence = page->cache_sequence.load(std::memory_order_relaxed);
+    page->cache_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    page->cache = cache;
+    page->cache_updated_ns = ipc_now_ns();
+    page->cache_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void IPCStats::refresh_loop()
+{
+    IPCSpinBudget budget;
+    budget.iterations = 0;
+    while (!stopping.load(std::memory_order_acquire)) {
+        uint32_t seen = ipc_event_prepare(&wake);
+        refresh_cache();
+        ipc_event_wait(&wake, seen, &budget, ipc_now_ns() + IPC_STATS_REFRESH_NS);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef IPC_STATS_H
+#define IPC_STATS_H
+
+#include "common.h"
+#include <thread>
+
+// Segment des métriques, lisible par un processus externe sans passer par
+// les routes : ouvrir IPC_STATS_NAME en lecture seule, vérifier magic et
+// version, puis additionner les shards
+#define IPC_STATS_NAME "/ipc_router_stats"
+#define IPC_STATS_MAGIC 0x49505353
+#define IPC_STATS_VERSION 1
+#define IPC_STATS_SHARDS 32        // Un par worker, partagés au-delà
+#define IPC_STATS_REFRESH_NS 1000000000ULL // Recopie des compteurs du cache
+
+// Histogramme à précision relative constante (façon HDR) : 16 buckets
+// linéaires par puissance de 2, soit 6 % d'erreur au plus, jusqu'à ~68 s
+#define IPC_STATS_SUB_BITS 4
+#define IPC_STATS_MAX_EXPONENT 36
+#define IPC_STATS_BUCKETS ((IPC_STATS_MAX_EXPONENT - IPC_STATS_SUB_BITS + 1) << IPC_STATS_SUB_BITS)
+
+inline uint32_t ipc_stats_bucket(uint64_t ns)
+{
+    if (ns < (1u << IPC_STATS_SUB_BITS)) {
+        return static_cast<uint32_t>(ns);
+    }
+    uint32_t exponent = 63 - __builtin_clzll(ns);
+    if (exponent >= IPC_STATS_MAX_EXPONENT) {
+        return IPC_STATS_BUCKETS - 1;
+    }
+    uint32_t shift = exponent - IPC_STATS_SUB_BITS;
+    return ((shift + 1) << IPC_STATS_SUB_BITS) +
+        static_cast<uint32_t>((ns >> shift) & ((1u << IPC_STATS_SUB_BITS) - 1));
+}
+
+// Plus grande valeur comptée dans `bucket`
+inline uint64_t ipc_stats_bucket_max(uint32_t bucket)
+{
+    if (bucket < (1u << IPC_STATS_SUB_BITS)) {
+        return bucket;
+    }
+    uint32_t shift = (bucket >> IPC_STATS_SUB_BITS) - 1;
+    uint64_t mantissa = (bucket & ((1u << IPC_STATS_SUB_BITS) - 1)) | (1u << IPC_STATS_SUB_BITS);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+// Compteurs d'une route dans un shard
+struct IPCRouteStats
+{
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> expired;
+    std::atomic<uint64_t> overloaded;
+    std::atomic<uint64_t> buckets[IPC_STATS_BUCKETS];
+};
+
+// Écrit par un seul worker (tant qu'il y en a au plus IPC_STATS_SHARDS) :
+// les incréments restent dans ses propres lignes de cache
+struct alignas(64) IPCStatsShard
+{
+    IPCRouteStats routes[IPC_ROUTE_COUNT];
+};
+
+struct IPCStatsPage
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t shard_count;
+    uint32_t route_count;
+    uint32_t bucket_count;
+    uint32_t sub_bucket_bits;
+    char route_names[IPC_ROUTE_COUNT][64];
+
+    // Recopié par le serveur toutes les IPC_STATS_REFRESH_NS ; séquence
+    // impaire pendant l'écriture, à relire si elle a changé
+    alignas(64) std::atomic<uint32_t> cache_sequence;
+    uint64_t cache_updated_ns;     // ipc_now_ns de la dernière recopie
+    CacheStatsSummary cache;
+
+    IPCStatsShard shards[IPC_STATS_SHARDS];
+};
+
+// Métriques du serveur : un shard par worker, publiées dans IPC_STATS_NAME
+class IPCStats
+{
+public:
+    IPCStats() = default;
+    ~IPCStats();
+
+    bool initialize();
+    // Thread de recopie des compteurs du cache dans la page
+    void start();
+    void stop();
+
+    IPCStatsShard* shard(unsigned worker) { return &page->shards[worker % IPC_STATS_SHARDS]; }
+
+    static void record(IPCRouteStats& route, uint64_t elapsed_ns);
+
+    // Somme des shards, percentiles compris
+    void summarize(GetStatsResponse* response) const;
+
+private:
+    void refresh_cache();
+    void refresh_loop();
+
+    IPCStatsPage* page = nullptr;
+    std::thread refresher;
+    std::atomic<bool> stopping{false};
+    IPCEvent wake{};
+};
+
+#endif // IPC_STATS_H
@@ -0,0 +1,84 @@
+#include "trace.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert((IPC_TRACE_EVENTS & (IPC_TRACE_EVENTS - 1)) == 0, "IPC_TRACE_EVENTS doit être une puissance de 2");
+
+std::atomic<bool> IPCTrace::active{false};
+
+namespace {
+
+    IPCTraceEvent events[IPC_TRACE_EVENTS];
+    std::atomic<uint64_t> next_event{0};
+
+    uint32_t current_thread_id()
+    {
+        static thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        return tid;
+    }
+
+    // Horodatages Chrome trace : microsecondes
+    void write_time(FILE* out, const char* key, uint64_t ns)
+    {
+        fprintf(out, "\"%s\":%" PRIu64 ".%03u", key, ns / 1000, static_cast<unsigned>(ns % 1000));
+    }
+
+} // namespace
+
+void IPCTrace::record(const char* name, uint64_t start_ns, uint64_t end_ns,
+    uint32_t message_id, uint32_t flow)
+{
+    uint64_t pos = next_event.fetch_add(1, std::memory_order_relaxed);
+    IPCTraceEvent& event = events[pos & (IPC_TRACE_EVENTS - 1)];
+    event.start_ns = start_ns;
+    event.end_ns = std::max(start_ns, end_ns);
+    event.name = name;
+    event.message_id = message_id;
+    event.thread_id = current_thread_id();
+    event.flow = flow;
+}
+
+bool IPCTrace::dump(const char* path, const char* process_name)
+{
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror("fopen trace");
+        return false;
+    }
+
+    const int pid = getpid();
+    uint64_t end = next_event.load(std::memory_order_acquire);
+    uint64_t begin = end > IPC_TRACE_EVENTS ? end - IPC_TRACE_EVENTS : 0;
+
+    fprintf(out, "{\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+        pid, process_name);
+    for (uint64_t pos = begin; pos < end; ++pos) {
+        const IPCTraceEvent& event = events[pos & (IPC_TRACE_EVENTS - 1)];
+        fprintf(out, ",\n{\"ph\":\"X\",\"cat\":\"ipc\",\"name\":\"%s\",\"pid\":%d,\"tid\":%u,",
+            event.name, pid, event.thread_id);
+        write_time(out, "ts", event.start_ns);
+        fputc(',', out);
+        write_time(out, "dur", event.end_ns - event.start_ns);
+        fprintf(out, ",\"args\":{\"message_id\":%u}}", event.message_id);
+
+        // Flèche client -> serveur, identifiée par le message
+        if (event.flow != IPC_TRACE_NO_FLOW) {
+            bool start = event.flow == IPC_TRACE_FLOW_START;
+            fprintf(out, ",\n{\"ph\":\"%s\",%s\"cat\":\"ipc\",\"name\":\"request\",\"id\":%u,\"pid\":%d,\"tid\":%u,",
+                start ? "s" : "f", start ? "" : "\"bp\":\"e\",", event.message_id, pid, event.thread_id);
+            write_time(out, "ts", event.start_ns);
+            fputc('}', out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    bool written = fclose(out) == 0;
+    if (written) {
+        fprintf(stderr, "Trace: %" PRIu64 " événements écrits dans %s\n", end - begin, path);
+    }
+    return written;
+}
@@ -0,0 +1,55 @@
+#ifndef IPC_TRACE_H
+#define IPC_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include "ipc_event.h"
+
+#define IPC_TRACE_EVENTS 65536     // Puissance de 2 ; les plus anciens sont écrasés
+
+// Lien entre la publication d'une requête par le client et sa prise en
+// charge par le serveur (flèche entre processus dans Perfetto)
+#define IPC_TRACE_NO_FLOW 0
+#define IPC_TRACE_FLOW_START 1
+#define IPC_TRACE_FLOW_END 2
+
+// Étape d'une requête, horodatée avec ipc_now_ns (horloge commune aux processus)
+struct IPCTraceEvent
+{
+    uint64_t start_ns;
+    uint64_t end_ns;
+    const char* name;              // Chaîne statique
+    uint32_t message_id;           // 0 : hors requête
+    uint32_t thread_id;
+    uint32_t flow;                 // IPC_TRACE_*FLOW*
+};
+
+// Traçage des requêtes, désactivé par défaut. Les étapes sont écrites dans
+// un anneau propre au processus, exporté au format Chrome trace (JSON) ;
+// les fichiers du client et du serveur se fusionnent en concaténant leurs
+// tableaux traceEvents.
+class IPCTrace
+{
+public:
+    static void enable() { active.store(true, std::memory_order_relaxed); }
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    // 0 si le traçage est désactivé : passer le résultat à record
+    static uint64_t start() { return enabled() ? ipc_now_ns() : 0; }
+    static void record(const char* name, uint64_t start_ns, uint64_t end_ns,
+        uint32_t message_id = 0, uint32_t flow = IPC_TRACE_NO_FLOW);
+    // Étape commencée par start(), terminée maintenant
+    static void finish(const char* name, uint64_t start_ns, uint32_t message_id = 0,
+        uint32_t flow = IPC_TRACE_NO_FLOW)
+    {
+        if (start_ns != 0) record(name, start_ns, ipc_now_ns(), message_id, flow);
+    }
+
+    // Écrit les événements de l'anneau ; à appeler une fois le trafic arrêté
+    static bool dump(const char* path, const char* process_name);
+
+private:
+    static std::atomic<bool> active;
+};
+
+#endif // IPC_TRACE_H